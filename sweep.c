@@ -35,6 +35,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #if HAVE_DECLSPEC
 #define EXPORT __declspec(dllexport)
@@ -49,15 +50,277 @@
 EXPORT int plugin_is_GPL_compatible;
 int plugin_is_GPL_compatible;
 
+struct sweep_profile_entry {
+  char *  name;
+  long    calls;
+  double  total_time;
+  double  max_time;
+  size_t  bytes_in;
+  size_t  bytes_out;
+  long    funcalls;
+  struct sweep_profile_entry * next;
+};
+
 struct sweep_env {
   term_t      output_term;
   emacs_env * current_env;
+  struct sweep_profile_entry * profile;
+  double      elapsed;
   struct sweep_env * next;
 };
 
 struct sweep_env * env_stack = NULL;
 int sweep_thread_id = -1;
 
+/* Query profiling.  The counters below are updated unconditionally,
+   profile entries only accumulate their deltas while profiling is
+   enabled.  Measurements are inclusive of nested queries. */
+
+int sweep_profiling = 0;
+struct sweep_profile_entry * profile_entries = NULL;
+size_t sweep_bytes_in  = 0;
+size_t sweep_bytes_out = 0;
+long   sweep_funcalls  = 0;
+
+struct sweep_profile_mark {
+  double time;
+  size_t bytes_in;
+  size_t bytes_out;
+  long   funcalls;
+};
+
+static double
+sweep_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void
+sweep_profile_mark(struct sweep_profile_mark * m) {
+  m->time      = sweep_now();
+  m->bytes_in  = sweep_bytes_in;
+  m->bytes_out = sweep_bytes_out;
+  m->funcalls  = sweep_funcalls;
+}
+
+static struct sweep_profile_entry *
+sweep_profile_lookup(const char * m, const char * f) {
+  struct sweep_profile_entry * e = NULL;
+  size_t len = strlen(m) + strlen(f) + 2;
+  char * name = (char*)malloc(len);
+
+  if (name == NULL) return NULL;
+  snprintf(name, len, "%s:%s", m, f);
+
+  for (e = profile_entries; e != NULL; e = e->next) {
+    if (strcmp(e->name, name) == 0) {
+      free(name);
+      return e;
+    }
+  }
+
+  if ((e = (struct sweep_profile_entry *)malloc(sizeof(*e))) == NULL) {
+    free(name);
+    return NULL;
+  }
+  memset(e, 0, sizeof(*e));
+  e->name = name;
+  e->next = profile_entries;
+  profile_entries = e;
+  return e;
+}
+
+static void
+sweep_profile_update(struct sweep_profile_mark * m) {
+  double d = 0;
+  if (env_stack == NULL || env_stack->profile == NULL) return;
+  d = sweep_now() - m->time;
+  env_stack->elapsed            += d;
+  env_stack->profile->total_time += d;
+  env_stack->profile->bytes_in   += sweep_bytes_in  - m->bytes_in;
+  env_stack->profile->bytes_out  += sweep_bytes_out - m->bytes_out;
+  env_stack->profile->funcalls   += sweep_funcalls  - m->funcalls;
+}
+
+static void
+sweep_profile_finish(struct sweep_env * e) {
+  if (e->profile != NULL && e->elapsed > e->profile->max_time) {
+    e->profile->max_time = e->elapsed;
+  }
+}
+
+static void
+sweep_profile_reset(void) {
+  struct sweep_profile_entry * e = profile_entries;
+  struct sweep_env * s = NULL;
+  while (e != NULL) {
+    struct sweep_profile_entry * n = e->next;
+    free(e->name);
+    free(e);
+    e = n;
+  }
+  profile_entries = NULL;
+  for (s = env_stack; s != NULL; s = s->next) s->profile = NULL;
+}
+
+/* Callback tracing.  While enabled, calls from Prolog to Elisp via
+   sweep_funcall/2,3 are counted per Elisp function, with the time
+   spent in Elisp separated from the time spent converting the
+   argument and the result, and a histogram of payload sizes.  The
+   most recent calls are also kept in a ring buffer of trace events. */
+
+#define SWEEP_TRACE_BUCKETS 8
+#define SWEEP_TRACE_EVENTS  65536
+
+struct sweep_callback_entry {
+  char *  name;
+  long    calls;
+  double  elisp_time;
+  double  convert_time;
+  size_t  bytes;
+  long    sizes[SWEEP_TRACE_BUCKETS];
+  struct sweep_callback_entry * next;
+};
+
+struct sweep_trace_event {
+  struct sweep_callback_entry * entry;
+  double  start;
+  double  elisp_time;
+  double  convert_time;
+  size_t  bytes;
+};
+
+struct sweep_callback_mark {
+  double time;
+  size_t bytes;
+};
+
+int sweep_tracing = 0;
+int sweep_callbacks_active = 0;
+int sweep_callback_reset_pending = 0;
+struct sweep_callback_entry * callback_entries = NULL;
+struct sweep_trace_event * trace_events = NULL;
+size_t trace_events_next  = 0;
+size_t trace_events_count = 0;
+
+static struct sweep_callback_entry *
+sweep_callback_lookup(const char * name) {
+  struct sweep_callback_entry * e = NULL;
+
+  for (e = callback_entries; e != NULL; e = e->next) {
+    if (strcmp(e->name, name) == 0) return e;
+  }
+
+  if ((e = (struct sweep_callback_entry *)malloc(sizeof(*e))) == NULL) {
+    return NULL;
+  }
+  memset(e, 0, sizeof(*e));
+  if ((e->name = strdup(name)) == NULL) {
+    free(e);
+    return NULL;
+  }
+  e->next = callback_entries;
+  callback_entries = e;
+  return e;
+}
+
+static void
+sweep_callback_mark(struct sweep_callback_mark * m) {
+  m->time  = sweep_now();
+  m->bytes = sweep_bytes_in + sweep_bytes_out;
+}
+
+/* Record a callback to Elisp.  ARG is taken before converting the
+   argument, CALL before calling Elisp, RET after Elisp returns and
+   END after converting the result. */
+
+static void
+sweep_callback_record(struct sweep_callback_entry * e,
+                      struct sweep_callback_mark * arg,
+                      struct sweep_callback_mark * call,
+                      struct sweep_callback_mark * ret,
+                      struct sweep_callback_mark * end) {
+  double elisp   = ret->time - call->time;
+  double convert = (call->time - arg->time) + (end->time - ret->time);
+  size_t bytes   = (call->bytes - arg->bytes) + (end->bytes - ret->bytes);
+  size_t bucket  = 0;
+  size_t limit   = 16;
+  struct sweep_trace_event * ev = NULL;
+
+  while (bucket < SWEEP_TRACE_BUCKETS - 1 && bytes >= limit) {
+    bucket++;
+    limit *= 4;
+  }
+
+  e->calls++;
+  e->elisp_time   += elisp;
+  e->convert_time += convert;
+  e->bytes        += bytes;
+  e->sizes[bucket]++;
+
+  if (trace_events != NULL) {
+    ev = &trace_events[trace_events_next];
+    ev->entry        = e;
+    ev->start        = arg->time;
+    ev->elisp_time   = elisp;
+    ev->convert_time = convert;
+    ev->bytes        = bytes;
+    trace_events_next = (trace_events_next + 1) % SWEEP_TRACE_EVENTS;
+    if (trace_events_count < SWEEP_TRACE_EVENTS) trace_events_count++;
+  }
+}
+
+/* Callbacks can be nested, for instance when Elisp queries Prolog
+   again, and an inner call may ask to discard the collected data.
+   Entries of callbacks that are still in flight must stay valid until
+   they are recorded, so in that case we defer the reset until the
+   outermost traced callback returns. */
+
+static void sweep_callback_reset_now(void);
+
+static void
+sweep_callback_reset(void) {
+  if (sweep_callbacks_active > 0) {
+    sweep_callback_reset_pending = 1;
+  } else sweep_callback_reset_now();
+}
+
+static void
+sweep_callback_leave(void) {
+  if (--sweep_callbacks_active == 0 && sweep_callback_reset_pending) {
+    sweep_callback_reset_pending = 0;
+    sweep_callback_reset_now();
+  }
+}
+
+static void
+sweep_callback_reset_now(void) {
+  struct sweep_callback_entry * e = callback_entries;
+  while (e != NULL) {
+    struct sweep_callback_entry * n = e->next;
+    free(e->name);
+    free(e);
+    e = n;
+  }
+  callback_entries   = NULL;
+  trace_events_next  = 0;
+  trace_events_count = 0;
+}
+
+/* Message notification.  Prolog sets this flag whenever it queues a
+   message for Emacs, from any thread, and Emacs clears it before it
+   collects the queued messages.  This way Emacs only queries Prolog
+   for messages when there are some. */
+
+volatile int sweep_messages_pending = 0;
+
+static foreign_t
+sweep_messages_notify(void) {
+  sweep_messages_pending = 1;
+  return TRUE;
+}
+
 int sweep_env_push() {
   int r = -1;
   struct sweep_env * e = (struct sweep_env *)malloc(sizeof(*e));
@@ -74,6 +337,7 @@ int sweep_env_pop() {
   int r = -1;
   struct sweep_env * e = env_stack;
   if (e != NULL) {
+    sweep_profile_finish(e);
     env_stack = e->next;
     free(e);
     r = 0;
@@ -113,7 +377,7 @@ estring_to_cstring(emacs_env *eenv, emacs_value estring, ptrdiff_t *len_p) {
     ethrow(eenv, "Failed to copy string contents");
     free(buf);
     buf = NULL;
-  }
+  } else sweep_bytes_in += (*len_p) - 1;
 
   return buf;
 }
@@ -189,7 +453,7 @@ term_to_value_string(emacs_env *eenv, term_t t) {
   emacs_value v = NULL;
   size_t      l = -1;
   if (PL_get_nchars(t, &l, &string, CVT_STRING|REP_UTF8|CVT_EXCEPTION)) {
-
+    sweep_bytes_out += l;
     v = eenv->make_string(eenv, string, l);
   }
   return v;
@@ -203,6 +467,7 @@ term_to_value_atom(emacs_env *eenv, term_t t) {
   size_t      l = -1;
 
   if (PL_get_nchars(t, &l, &string, CVT_ATOM|REP_UTF8|CVT_EXCEPTION)) {
+    sweep_bytes_out += l;
     s = eenv->make_string(eenv, string, l);
     v = econs(eenv, eenv->intern(eenv, "atom"), s);
   }
@@ -244,6 +509,7 @@ term_to_value_compound(emacs_env *env, term_t t) {
   }
 
   chars = PL_atom_nchars(name, &len);
+  sweep_bytes_out += len;
 
   vals = (emacs_value*)malloc(sizeof(emacs_value)*arity + 1);
   if (vals == NULL) {
@@ -412,6 +678,8 @@ emacs_value
 sweep_next_solution(emacs_env *env, ptrdiff_t nargs, emacs_value *args, void *data)
 {
   qid_t d = PL_current_query();
+  struct sweep_profile_mark pm;
+  emacs_value r = NULL;
 
   (void)data;
   (void)nargs;
@@ -422,20 +690,30 @@ sweep_next_solution(emacs_env *env, ptrdiff_t nargs, emacs_value *args, void *da
     return NULL;
   }
 
+  sweep_profile_mark(&pm);
+
   env_stack->current_env = env;
 
   switch (PL_next_solution(d)) {
   case PL_S_EXCEPTION:
-    return econs(env, env->intern(env, "exception"), term_to_value(env, PL_exception(d)));
+    r = econs(env, env->intern(env, "exception"), term_to_value(env, PL_exception(d)));
+    break;
   case PL_S_FALSE:
-    return enil(env);
+    r = enil(env);
+    break;
   case PL_S_TRUE:
-    return econs(env, et(env), term_to_value(env, env_stack->output_term));
+    r = econs(env, et(env), term_to_value(env, env_stack->output_term));
+    break;
   case PL_S_LAST:
-    return econs(env, env->intern(env, "!"), term_to_value(env, env_stack->output_term));
+    r = econs(env, env->intern(env, "!"), term_to_value(env, env_stack->output_term));
+    break;
   default:
-    return NULL;
+    r = NULL;
   }
+
+  sweep_profile_update(&pm);
+
+  return r;
 }
 
 emacs_value
@@ -449,8 +727,11 @@ sweep_open_query(emacs_env *env, ptrdiff_t nargs, emacs_value *args, void *data)
   term_t      a = PL_new_term_refs(2);
   emacs_value r = enil(env);
   emacs_value s = NULL;
+  struct sweep_profile_mark pm;
 
   (void)data;
+  sweep_profile_mark(&pm);
+
   if (nargs == 4) {
     s = enil(env);
   } else {
@@ -485,6 +766,12 @@ sweep_open_query(emacs_env *env, ptrdiff_t nargs, emacs_value *args, void *data)
 
   env_stack->output_term = a+(env->is_not_nil(env, s) ? 0 : 1);
 
+  if (sweep_profiling &&
+      (env_stack->profile = sweep_profile_lookup(m, f)) != NULL) {
+    env_stack->profile->calls++;
+    sweep_profile_update(&pm);
+  }
+
   r = et(env);
 
  cleanup:
@@ -513,8 +800,11 @@ sweep_funcall0(term_t f, term_t v) {
   char * string = NULL;
   emacs_value r = NULL;
   size_t      l = -1;
+  int         i = -1;
   term_t      n = PL_new_term_ref();
   emacs_env * env = NULL;
+  struct sweep_callback_entry * c = NULL;
+  struct sweep_callback_mark call, ret, end;
 
   if (PL_thread_self() != sweep_thread_id || env_stack == NULL) {
     PL_permission_error("sweep_funcall", "elisp_environment", f);
@@ -524,8 +814,20 @@ sweep_funcall0(term_t f, term_t v) {
   env = env_stack->current_env;
 
   if (PL_get_nchars(f, &l, &string, CVT_STRING|REP_UTF8|CVT_EXCEPTION)) {
+    sweep_funcalls++;
+    if (sweep_tracing && (c = sweep_callback_lookup(string)) != NULL) {
+      sweep_callbacks_active++;
+      sweep_callback_mark(&call);
+    }
     r = env->funcall(env, env->intern(env, string), 0, NULL);
-    if (value_to_term(env, r, n) >= 0) {
+    if (c != NULL) sweep_callback_mark(&ret);
+    i = value_to_term(env, r, n);
+    if (c != NULL) {
+      sweep_callback_mark(&end);
+      sweep_callback_record(c, &call, &call, &ret, &end);
+      sweep_callback_leave();
+    }
+    if (i >= 0) {
       if (PL_unify(n, v)) {
         return TRUE;
       }
@@ -540,8 +842,11 @@ sweep_funcall1(term_t f, term_t a, term_t v) {
   emacs_value e = NULL;
   emacs_value r = NULL;
   size_t      l = -1;
+  int         i = -1;
   term_t      n = PL_new_term_ref();
   emacs_env * env = NULL;
+  struct sweep_callback_entry * c = NULL;
+  struct sweep_callback_mark arg, call, ret, end;
 
   if (PL_thread_self() != sweep_thread_id || env_stack == NULL) {
     PL_permission_error("sweep_funcall", "elisp_environment", f);
@@ -551,13 +856,26 @@ sweep_funcall1(term_t f, term_t a, term_t v) {
   env = env_stack->current_env;
 
   if (PL_get_nchars(f, &l, &string, CVT_STRING|REP_UTF8|CVT_EXCEPTION)) {
+    sweep_funcalls++;
+    if (sweep_tracing && (c = sweep_callback_lookup(string)) != NULL) {
+      sweep_callbacks_active++;
+      sweep_callback_mark(&arg);
+    }
     e = term_to_value(env, a);
     if (e != NULL) {
+      if (c != NULL) sweep_callback_mark(&call);
       r = env->funcall(env, env->intern(env, string), 1, &e);
-      if (value_to_term(env, r, n) >= 0) {
-        if (PL_unify(n, v)) {
-          return TRUE;
-        }
+      if (c != NULL) sweep_callback_mark(&ret);
+      i = value_to_term(env, r, n);
+      if (c != NULL) {
+        sweep_callback_mark(&end);
+        sweep_callback_record(c, &arg, &call, &ret, &end);
+      }
+    }
+    if (c != NULL) sweep_callback_leave();
+    if (i >= 0) {
+      if (PL_unify(n, v)) {
+        return TRUE;
       }
     }
   }
@@ -587,6 +905,7 @@ sweep_initialize(emacs_env *env, ptrdiff_t nargs, emacs_value *args, void *data)
   PL_register_foreign("sweep_funcall", 3, sweep_funcall1, 0);
   PL_register_foreign("sweep_funcall", 2, sweep_funcall0, 0);
   PL_register_foreign("sweep_fd_open", 2, sweep_fd_open,  0);
+  PL_register_foreign("sweep_messages_notify", 0, sweep_messages_notify, 0);
 
   r = PL_initialise((int)nargs, argv);
 
@@ -620,6 +939,131 @@ sweep_cleanup(emacs_env *env, ptrdiff_t nargs, emacs_value *args, void *data)
   return env->intern(env, (PL_cleanup(PL_CLEANUP_SUCCESS) ? "t" : "nil"));
 }
 
+static emacs_value
+sweep_messages_pending_p(emacs_env *env, ptrdiff_t nargs, emacs_value *args, void *data)
+{
+  (void)nargs;
+  (void)args;
+  (void)data;
+  if (sweep_messages_pending) {
+    sweep_messages_pending = 0;
+    return et(env);
+  } else return enil(env);
+}
+
+static emacs_value
+sweep_profile_enable(emacs_env *env, ptrdiff_t nargs, emacs_value *args, void *data)
+{
+  (void)nargs;
+  (void)data;
+  sweep_profiling = env->is_not_nil(env, args[0]);
+  return sweep_profiling ? et(env) : enil(env);
+}
+
+static emacs_value
+sweep_profile_data(emacs_env *env, ptrdiff_t nargs, emacs_value *args, void *data)
+{
+  struct sweep_profile_entry * e = NULL;
+  emacs_value r = enil(env);
+
+  (void)data;
+
+  for (e = profile_entries; e != NULL; e = e->next) {
+    emacs_value vals[7] = {
+      env->make_string(env, e->name, strlen(e->name)),
+      env->make_integer(env, e->calls),
+      env->make_float(env, e->total_time),
+      env->make_float(env, e->max_time),
+      env->make_integer(env, (intmax_t)e->bytes_in),
+      env->make_integer(env, (intmax_t)e->bytes_out),
+      env->make_integer(env, e->funcalls)
+    };
+    r = econs(env, env->funcall(env, env->intern(env, "list"), 7, vals), r);
+  }
+
+  if (nargs == 1 && env->is_not_nil(env, args[0])) {
+    sweep_profile_reset();
+  }
+
+  return r;
+}
+
+static emacs_value
+sweep_callback_trace_enable(emacs_env *env, ptrdiff_t nargs, emacs_value *args, void *data)
+{
+  (void)nargs;
+  (void)data;
+  if (env->is_not_nil(env, args[0])) {
+    if (trace_events == NULL) {
+      trace_events = (struct sweep_trace_event *)malloc(sizeof(struct sweep_trace_event)
+                                                        * SWEEP_TRACE_EVENTS);
+      if (trace_events == NULL) {
+        ethrow(env, "malloc failed");
+        return NULL;
+      }
+    }
+    sweep_tracing = 1;
+  } else sweep_tracing = 0;
+  return sweep_tracing ? et(env) : enil(env);
+}
+
+static emacs_value
+sweep_callback_trace_data(emacs_env *env, ptrdiff_t nargs, emacs_value *args, void *data)
+{
+  struct sweep_callback_entry * e = NULL;
+  emacs_value r = enil(env);
+  size_t i = 0;
+
+  (void)data;
+
+  for (e = callback_entries; e != NULL; e = e->next) {
+    emacs_value sizes[SWEEP_TRACE_BUCKETS];
+    for (i = 0; i < SWEEP_TRACE_BUCKETS; i++) {
+      sizes[i] = env->make_integer(env, e->sizes[i]);
+    }
+    emacs_value vals[6] = {
+      env->make_string(env, e->name, strlen(e->name)),
+      env->make_integer(env, e->calls),
+      env->make_float(env, e->elisp_time),
+      env->make_float(env, e->convert_time),
+      env->make_integer(env, (intmax_t)e->bytes),
+      env->funcall(env, env->intern(env, "list"), SWEEP_TRACE_BUCKETS, sizes)
+    };
+    r = econs(env, env->funcall(env, env->intern(env, "list"), 6, vals), r);
+  }
+
+  if (nargs == 1 && env->is_not_nil(env, args[0])) {
+    sweep_callback_reset();
+  }
+
+  return r;
+}
+
+static emacs_value
+sweep_callback_trace_events(emacs_env *env, ptrdiff_t nargs, emacs_value *args, void *data)
+{
+  emacs_value r = enil(env);
+  size_t i = 0;
+
+  (void)nargs;
+  (void)args;
+  (void)data;
+
+  for (i = 1; i <= trace_events_count; i++) {
+    struct sweep_trace_event * ev =
+      &trace_events[(trace_events_next + SWEEP_TRACE_EVENTS - i) % SWEEP_TRACE_EVENTS];
+    emacs_value vals[5] = {
+      env->make_string(env, ev->entry->name, strlen(ev->entry->name)),
+      env->make_float(env, ev->start),
+      env->make_float(env, ev->elisp_time),
+      env->make_float(env, ev->convert_time),
+      env->make_integer(env, (intmax_t)ev->bytes)
+    };
+    r = econs(env, env->funcall(env, env->intern(env, "list"), 5, vals), r);
+  }
+
+  return r;
+}
 
 static void provide(emacs_env *env, const char *feature) {
   emacs_value Qfeat = env->intern(env, feature);
@@ -710,6 +1154,78 @@ This function drops the current instantiation of the query variables.",
   emacs_value args_cleanup[] = {symbol_cleanup, func_cleanup};
   env->funcall (env, env->intern (env, "defalias"), 2, args_cleanup);
 
+  emacs_value symbol_messages_pending = env->intern (env, "sweeprolog-messages-pending-p");
+  emacs_value func_messages_pending =
+    env->make_function(env,
+                       0, 0,
+                       sweep_messages_pending_p,
+                       "Return t if Prolog queued messages since the last call, else return nil.\n\
+Each call resets the indication, so the caller should then collect all queued messages.",
+                       NULL);
+  emacs_value args_messages_pending[] = {symbol_messages_pending, func_messages_pending};
+  env->funcall (env, env->intern (env, "defalias"), 2, args_messages_pending);
+
+  emacs_value symbol_profile_enable = env->intern (env, "sweeprolog-profile-enable");
+  emacs_value func_profile_enable =
+    env->make_function(env,
+                       1, 1,
+                       sweep_profile_enable,
+                       "Enable profiling of Prolog queries if ARG1 is non-nil, else disable it.\n\
+Return t if profiling is now enabled, nil otherwise.\n\
+See also `sweeprolog-profile-data'.",
+                       NULL);
+  emacs_value args_profile_enable[] = {symbol_profile_enable, func_profile_enable};
+  env->funcall (env, env->intern (env, "defalias"), 2, args_profile_enable);
+
+  emacs_value symbol_profile_data = env->intern (env, "sweeprolog-profile-data");
+  emacs_value func_profile_data =
+    env->make_function(env,
+                       0, 1,
+                       sweep_profile_data,
+                       "Return the statistics collected while profiling Prolog queries.\n\
+The value is a list with one element for each Prolog predicate invoked via `sweeprolog-open-query'.\n\
+Each element is a list (NAME CALLS TOTAL MAX BYTES-IN BYTES-OUT FUNCALLS), where NAME is a string of the form MODULE:PREDICATE, CALLS is the number of queries, TOTAL and MAX are the total and maximal wall time of a query in seconds, BYTES-IN and BYTES-OUT are the number of string bytes converted from Elisp to Prolog and from Prolog to Elisp, and FUNCALLS is the number of calls back to Elisp with `sweep_funcall'.\n\
+If ARG1 is non-nil, also discard all collected statistics.",
+                       NULL);
+  emacs_value args_profile_data[] = {symbol_profile_data, func_profile_data};
+  env->funcall (env, env->intern (env, "defalias"), 2, args_profile_data);
+
+  emacs_value symbol_callback_trace_enable = env->intern (env, "sweeprolog-callback-trace-enable");
+  emacs_value func_callback_trace_enable =
+    env->make_function(env,
+                       1, 1,
+                       sweep_callback_trace_enable,
+                       "Enable tracing calls from Prolog to Elisp if ARG1 is non-nil, else disable it.\n\
+Return t if tracing is now enabled, nil otherwise.\n\
+See also `sweeprolog-callback-trace-data' and `sweeprolog-callback-trace-events'.",
+                       NULL);
+  emacs_value args_callback_trace_enable[] = {symbol_callback_trace_enable, func_callback_trace_enable};
+  env->funcall (env, env->intern (env, "defalias"), 2, args_callback_trace_enable);
+
+  emacs_value symbol_callback_trace_data = env->intern (env, "sweeprolog-callback-trace-data");
+  emacs_value func_callback_trace_data =
+    env->make_function(env,
+                       0, 1,
+                       sweep_callback_trace_data,
+                       "Return the statistics collected while tracing calls from Prolog to Elisp.\n\
+The value is a list with one element for each Elisp function called via `sweep_funcall'.\n\
+Each element is a list (NAME CALLS ELISP CONVERT BYTES SIZES), where NAME is the name of the function, CALLS is the number of calls, ELISP is the total time in seconds spent in Elisp, CONVERT is the total time in seconds spent converting arguments and results, BYTES is the total number of string bytes converted, and SIZES is a histogram of the bytes converted per call, with buckets for less than 16, 64, 256, 1K, 4K, 16K and 64K bytes and a final bucket for larger payloads.\n\
+If ARG1 is non-nil, also discard all collected statistics and trace events, or, when called from within a traced call, as soon as the outermost traced call returns.",
+                       NULL);
+  emacs_value args_callback_trace_data[] = {symbol_callback_trace_data, func_callback_trace_data};
+  env->funcall (env, env->intern (env, "defalias"), 2, args_callback_trace_data);
+
+  emacs_value symbol_callback_trace_events = env->intern (env, "sweeprolog-callback-trace-events");
+  emacs_value func_callback_trace_events =
+    env->make_function(env,
+                       0, 0,
+                       sweep_callback_trace_events,
+                       "Return the most recent calls from Prolog to Elisp, oldest first.\n\
+Each element is a list (NAME START ELISP CONVERT BYTES), where START is the monotonic clock time in seconds at which the call started, and the other elements are as in `sweeprolog-callback-trace-data'.",
+                       NULL);
+  emacs_value args_callback_trace_events[] = {symbol_callback_trace_events, func_callback_trace_events};
+  env->funcall (env, env->intern (env, "defalias"), 2, args_callback_trace_events);
+
 #if defined EMACS_MAJOR_VERSION && EMACS_MAJOR_VERSION >= 28
   emacs_value symbol_open_channel = env->intern (env, "sweeprolog-open-channel");
   emacs_value func_open_channel = env->make_function (env, 1, 1, sweep_open_channel, "Open channel.", NULL);
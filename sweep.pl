@@ -32,11 +32,14 @@
 
 :- module(sweep,
           [ sweep_setup_message_hook/2,
+            sweep_message_batch/2,
+            sweep_set_message_limit/2,
             sweep_current_prolog_flags/2,
             sweep_set_prolog_flag/2,
             sweep_expand_file_name/2,
             sweep_path_module/2,
             sweep_load_buffer/2,
+            sweep_reconsult_buffer/2,
             sweep_colourise_query/2,
             sweep_predicate_references/2,
             sweep_predicate_location/2,
@@ -47,14 +50,18 @@
             sweep_packs_collection/2,
             sweep_pack_install/2,
             sweep_op_info/2,
+            sweep_op_table/2,
             sweep_imenu_index/2,
             sweep_module_path/2,
             sweep_thread_signal/2,
             sweep_top_level_server/2,
             sweep_accept_top_level_client/2,
+            sweep_top_level_local_server/2,
+            sweep_accept_top_level_local_client/2,
             sweep_local_predicate_export_comment/2,
             write_sweep_module_location/0,
             sweep_module_html_documentation/2,
+            sweep_html_documentation_prewarm/2,
             sweep_predicate_html_documentation/2,
             sweep_predicate_properties/2,
             sweep_analyze_region/2,
@@ -71,17 +78,31 @@
             sweep_format_head/2,
             sweep_format_term/2,
             sweep_current_functors/2,
+            sweep_functors_page/2,
             sweep_term_replace/2,
+            sweep_project_replace_start/2,
+            sweep_project_replace_files/2,
+            sweep_project_replace_done/2,
+            sweep_functor_occurrences/2,
             sweep_terms_at_point/2,
+            sweep_term_tokens/2,
             sweep_predicate_dependencies/2,
+            sweep_unused_dependencies/2,
+            sweep_dependency_cycles/2,
+            sweep_dependency_graph_dot/2,
             sweep_async_goal/2,
             sweep_interrupt_async_goal/2,
+            sweep_set_async_pool/2,
+            sweep_async_schedule/2,
+            sweep_async_jobs/2,
+            sweep_async_jobs_clear/2,
             sweep_source_file_load_time/2,
             sweep_set_breakpoint/2,
             sweep_set_breakpoint_condition/2,
             sweep_delete_breakpoint/2,
             sweep_current_breakpoints/2,
             sweep_current_breakpoints_in_region/2,
+            sweep_breakpoints_at_point/2,
             sweep_breakpoint_range/2,
             sweep_breakpoint_file/2,
             sweep_expand_macro/2,
@@ -96,6 +117,7 @@
             sweep_top_level_start_pty/2,
             sweep_cleanup_threads/2,
             sweep_kill_thread/2,
+            sweep_thread_statistics/2,
             sweep_list_threads/2,
             sweep_extract_goal/2,
             sweep_path_alias_collection/2,
@@ -108,7 +130,13 @@
             sweep_function_functors_collection/2,
             sweep_nohup/2,
             sweep_short_documentation/2,
-            sweep_flags_collection/2
+            sweep_flags_collection/2,
+            sweep_memory_report/2,
+            sweep_xref_purge/2,
+            sweep_garbage_collect/2,
+            sweep_set_xref_cache_limit/2,
+            sweep_set_comment_modes_cache_limit/2,
+            sweep_xref_release/2
           ]).
 
 :- use_module(library(pldoc)).
@@ -140,7 +168,24 @@
 :- meta_predicate with_buffer_stream(-, +, 0).
 
 :- dynamic sweep_open_buffer/3,
-           sweep_current_comment/3.
+           sweep_current_comment/3,
+           sweep_xref_last_use/2,
+           sweep_xref_cache_limit/1,
+           sweep_comment_modes_entry/4,
+           sweep_comment_modes_cache_limit/1,
+           sweep_definition_index/2,
+           sweep_definition_line/3,
+           sweep_parse_cache/2,
+           sweep_source_clauses_cache/4,
+           sweep_project_replace_job/4,
+           sweep_project_replace_match/2,
+           sweep_functor_index/2,
+           sweep_functor_occurrence/6,
+           sweep_functor_index_qq/2,
+           sweep_async_pool/2,
+           sweep_async_worker/2,
+           sweep_async_job/5,
+           sweep_async_job_queued/4.
 
 :- multifile prolog:xref_source_time/2,
              prolog:xref_open_source/2,
@@ -181,11 +226,16 @@ sweep_list_threads(IdBufferPairs, Ts) :-
             (   member([Buffer|Id], IdBufferPairs),
                 thread_property(Id, status(Status0)),
                 term_string(Status0, Status),
-                thread_statistics(Id, stack, Stack),
-                thread_statistics(Id, cputime, CPUTime)
+                sweep_thread_usage(Id, Stack, CPUTime)
             ),
             Ts).
 
+sweep_thread_usage(Id, Stack, CPUTime) :-
+    catch(( thread_statistics(Id, stack, Stack),
+            thread_statistics(Id, cputime, CPUTime)
+          ),
+          _, fail).
+
 sweep_current_prolog_flags(Sub, Flags) :-
     findall([Flag|Value],
             (current_prolog_flag(Flag0, Value0),
@@ -201,7 +251,373 @@ sweep_set_prolog_flag([Flag0|Value0], true) :-
 
 sweep_xref_source(Path0, _) :-
     atom_string(Path, Path0),
-    xref_source(Path, [comments(store)]).
+    sweep_xref(Path).
+
+%!  sweep_xref(+Source) is det.
+%
+%   Cross reference Source, storing comments, and mark it as the most
+%   recently used source.  If this leaves more cross referenced sources
+%   than sweep_xref_cache_limit/1 allows, discard the data of the least
+%   recently used ones.  Callers re-run sweep_xref/1 before they use the
+%   data, so evicted sources are transparently re-indexed on demand.
+
+sweep_xref(Source) :-
+    xref_source(Source, [comments(store)]),
+    flag(sweep_xref_clock, Stamp, Stamp + 1),
+    retractall(sweep_xref_last_use(Source, _)),
+    assertz(sweep_xref_last_use(Source, Stamp)),
+    sweep_xref_enforce_limit.
+
+sweep_xref_enforce_limit :-
+    (   sweep_xref_cache_limit(Max)
+    ->  with_mutex(sweep_xref, sweep_xref_enforce_limit(Max))
+    ;   true
+    ).
+
+sweep_xref_enforce_limit(Max) :-
+    findall(Stamp-Source,
+            (   xref_current_source(Source),
+                atom(Source),
+                (   sweep_xref_last_use(Source, Stamp)
+                ->  true
+                ;   Stamp = -1
+                )
+            ),
+            Pairs0),
+    length(Pairs0, Count),
+    (   Count > Max
+    ->  keysort(Pairs0, Pairs),
+        Drop is Count - Max,
+        length(Evict, Drop),
+        append(Evict, _, Pairs),
+        forall(member(_-Source, Evict), sweep_xref_evict(Source))
+    ;   true
+    ).
+
+sweep_xref_evict(Source) :-
+    retractall(sweep_xref_last_use(Source, _)),
+    retractall(sweep_definition_index(Source, _)),
+    retractall(sweep_definition_line(Source, _, _)),
+    retractall(sweep_source_clauses_cache(Source, _, _, _)),
+    retractall(sweep_eldoc_cache(predicate(Source, _, _, _), _, _)),
+    retractall(sweep_dependencies_cache(Source, _, _)),
+    sweep_comment_modes_clean(Source),
+    with_mutex(sweep_functor_index, sweep_functor_index_clean(Source)),
+    xref_clean(Source).
+
+sweep_set_xref_cache_limit(Max, _) :-
+    retractall(sweep_xref_cache_limit(_)),
+    (   integer(Max)
+    ->  assertz(sweep_xref_cache_limit(Max)),
+        sweep_xref_enforce_limit
+    ;   true
+    ).
+
+sweep_xref_release(Path0, _) :-
+    atom_string(Path, Path0),
+    (   xref_current_source(Path)
+    ->  sweep_xref_evict(Path)
+    ;   true
+    ).
+
+%!  sweep_definition_line_(+Source, ?Head, -Line) is nondet.
+%
+%   True when Head is defined in Source starting at Line.  Lines come
+%   from an index that is built from the cross reference data of Source
+%   once per modification time of Source, so looking up definitions
+%   does not cross reference Source again unless it changed.
+
+sweep_definition_line_(Source, Head, Line) :-
+    sweep_source_time(Source, Time),
+    (   sweep_definition_index(Source, Time)
+    ->  true
+    ;   sweep_xref(Source),
+        retractall(sweep_definition_line(Source, _, _)),
+        forall(( xref_defined(Source, H, How),
+                 xref_definition_line(How, L)
+               ),
+               assertz(sweep_definition_line(Source, H, L))),
+        retractall(sweep_definition_index(Source, _)),
+        assertz(sweep_definition_index(Source, Time))
+    ),
+    sweep_definition_line(Source, Head, Line).
+
+sweep_source_time(Source, Time) :-
+    (   prolog:xref_source_time(Source, Time)
+    ->  true
+    ;   exists_file(Source)
+    ->  time_file(Source, Time)
+    ;   Time = 0
+    ).
+
+%!  sweep_read_context(+Path, -Module, -Ops) is det.
+%
+%   Module and Ops are the module and operators that apply to terms
+%   read from Path, or user and [] if Path is unbound.
+
+sweep_read_context(Path, Module, Ops) :-
+    (   nonvar(Path)
+    ->  findall(Op, xref_op(Path, Op), Ops),
+        sweep_module_path_(Module, Path)
+    ;   Module = user, Ops = []
+    ).
+
+%!  sweep_parse_term(?Path, +String, -Term, -Pos, -VarNames) is semidet.
+%
+%   Read Term from String in the context of Path, with subterm
+%   positions Pos relative to the start of String.  Parses are shared
+%   between commands that read the same text in the same context, so
+%   successive structural commands on an unchanged clause read it once.
+
+sweep_parse_term(Path, String, Term, Pos, VarNames) :-
+    sweep_read_context(Path, Module, Ops),
+    term_hash(String, StringHash),
+    term_hash(Module-Ops, ContextHash),
+    Key = term(StringHash, ContextHash),
+    (   sweep_parse_cache(Key, parse(String0, Term, Pos, VarNames)),
+        String0 == String
+    ->  true
+    ;   with_buffer_stream(
+            Stream,
+            String,
+            (   ignore((   nonvar(Path),
+                           set_stream(Stream, file_name(Path))
+                       )),
+                read_source_term_at_location(Stream, Term,
+                                             [module(Module),
+                                              operators(Ops),
+                                              subterm_positions(Pos),
+                                              variable_names(VarNames)])
+            )),
+        nonvar(Pos),
+        sweep_parse_cache_add(Key, parse(String, Term, Pos, VarNames))
+    ).
+
+%!  sweep_source_clauses(+Path, -Clauses) is det.
+%!  sweep_source_clauses(+Path, -Time, -Clauses) is det.
+%
+%   Clauses is a list of clause(Term, Pos, VarNames) terms for the
+%   clauses of Path, read once per modification time Time of Path.
+%   Whole files are much larger than the single terms in
+%   sweep_parse_cache/2, so we keep them in a separate cache of at
+%   most sweep_source_clauses_cache_limit/1 files, and drop the least
+%   recently used file when it is full.
+
+sweep_source_clauses_cache_limit(8).
+
+sweep_source_clauses(Path, Clauses) :-
+    sweep_source_clauses(Path, _, Clauses).
+
+sweep_source_clauses(Path, Time, Clauses) :-
+    sweep_source_time(Path, Time),
+    (   Time \== 0,
+        with_mutex(sweep_source_clauses,
+                   sweep_source_clauses_cached(Path, Time, Clauses))
+    ->  true
+    ;   setup_call_cleanup(prolog_open_source(Path, Stream),
+                           sweep_read_clauses(Stream, Clauses),
+                           prolog_close_source(Stream)),
+        (   Time == 0
+        ->  true
+        ;   with_mutex(sweep_source_clauses,
+                       sweep_source_clauses_add(Path, Time, Clauses))
+        )
+    ).
+
+sweep_source_clauses_cached(Path, Time, Clauses) :-
+    retract(sweep_source_clauses_cache(Path, Time, _, Clauses)),
+    flag(sweep_source_clauses_clock, Stamp, Stamp + 1),
+    assertz(sweep_source_clauses_cache(Path, Time, Stamp, Clauses)).
+
+sweep_source_clauses_add(Path, Time, Clauses) :-
+    retractall(sweep_source_clauses_cache(Path, _, _, _)),
+    flag(sweep_source_clauses_clock, Stamp, Stamp + 1),
+    assertz(sweep_source_clauses_cache(Path, Time, Stamp, Clauses)),
+    sweep_source_clauses_cache_limit(Max),
+    findall(S-P, sweep_source_clauses_cache(P, _, S, _), Pairs0),
+    length(Pairs0, Count),
+    (   Count > Max
+    ->  keysort(Pairs0, Pairs),
+        Drop is Count - Max,
+        length(Evict, Drop),
+        append(Evict, _, Pairs),
+        forall(member(_-P, Evict),
+               retractall(sweep_source_clauses_cache(P, _, _, _)))
+    ;   true
+    ).
+
+sweep_read_clauses(Stream, Clauses) :-
+    (   read_clause(Stream, Term, [subterm_positions(Pos),
+                                   variable_names(VarNames),
+                                   syntax_errors(dec10)])
+    ->  (   Term == end_of_file
+        ->  Clauses = []
+        ;   Clauses = [clause(Term, Pos, VarNames)|Tail],
+            sweep_read_clauses(Stream, Tail)
+        )
+    ;   sweep_read_clauses(Stream, Clauses)
+    ).
+
+%!  sweep_functor_index_ensure(+Source, +Time, +Clauses) is semidet.
+%
+%   Make sure that the functor occurrence index of Source reflects
+%   Clauses, the clauses of Source at modification time Time.  Each
+%   callable subterm of the I-th clause of Source is recorded as
+%   sweep_functor_occurrence(Name, Arity, Source, I, Beg, End).  Fails
+%   if Time is 0, meaning that we cannot tell when Source changes.
+%
+%   We compute the new entries without holding the sweep_functor_index
+%   mutex and swap them in under it, so that other threads can index
+%   other sources meanwhile.  Readers of the index take the mutex too,
+%   and thus never see a partially built index.
+
+sweep_functor_index_ensure(Source, Time, Clauses) :-
+    Time \== 0,
+    (   with_mutex(sweep_functor_index, sweep_functor_index(Source, Time))
+    ->  true
+    ;   findall(Entry,
+                (   nth1(I, Clauses, clause(Term, Pos, _)),
+                    sweep_term_occurrence(Term, Pos, Sub, SubPos),
+                    sweep_functor_index_entry(Source, I, Sub, SubPos, Entry)
+                ),
+                Entries),
+        with_mutex(sweep_functor_index,
+                   sweep_functor_index_swap(Source, Time, Entries))
+    ).
+
+sweep_functor_index_swap(Source, Time, _) :-
+    sweep_functor_index(Source, Time),
+    !.
+sweep_functor_index_swap(Source, Time, Entries) :-
+    sweep_functor_index_clean(Source),
+    forall(member(Entry, Entries), assertz(Entry)),
+    assertz(sweep_functor_index(Source, Time)),
+    sweep_functor_index_enforce_limit.
+
+%   Sources that we index without cross referencing them, such as the
+%   files of sweep_functor_occurrences/2, are not evicted along with
+%   cross reference data, so we also bound the number of indexed
+%   sources on its own, dropping the ones we indexed first.
+
+sweep_functor_index_limit(1024).
+
+sweep_functor_index_enforce_limit :-
+    sweep_functor_index_limit(Max),
+    predicate_property(sweep_functor_index(_, _), number_of_clauses(N)),
+    N > Max,
+    !,
+    Drop is N - Max,
+    findall(Source, limit(Drop, sweep_functor_index(Source, _)), Sources),
+    maplist(sweep_functor_index_clean, Sources).
+sweep_functor_index_enforce_limit.
+
+sweep_functor_index_clean(Source) :-
+    retractall(sweep_functor_index(Source, _)),
+    retractall(sweep_functor_occurrence(_, _, Source, _, _, _)),
+    retractall(sweep_functor_index_qq(Source, _)).
+
+sweep_functor_index_entry(Source, I, _, SubPos, Entry) :-
+    compound(SubPos),
+    SubPos = quasi_quotation_position(_, _, _, _, _),
+    !,
+    Entry = sweep_functor_index_qq(Source, I).
+sweep_functor_index_entry(Source, I, Sub, SubPos, Entry) :-
+    callable(Sub),
+    nonvar(SubPos),
+    functor(Sub, Name, Arity),
+    pos_bounds(SubPos, Beg, End),
+    Entry = sweep_functor_occurrence(Name, Arity, Source, I, Beg, End).
+
+%!  sweep_term_occurrence(+Term, +Pos, -Sub, -SubPos) is nondet.
+%
+%   Sub is a subterm of Term, including Term itself, with position
+%   SubPos according to the subterm positions Pos of Term.
+
+sweep_term_occurrence(Term, Pos, Term, Pos).
+sweep_term_occurrence(Term, Pos, Sub, SubPos) :-
+    nonvar(Pos),
+    sweep_sub_position(Term, Pos, Term1, Pos1),
+    sweep_term_occurrence(Term1, Pos1, Sub, SubPos).
+
+sweep_sub_position(Term, parentheses_term_position(_, _, Pos), Term, Pos).
+sweep_sub_position({Arg}, brace_term_position(_, _, Pos), Arg, Pos).
+sweep_sub_position(Term, term_position(_, _, _, _, ArgsPos), Arg, Pos) :-
+    compound(Term),
+    nth1(I, ArgsPos, Pos),
+    arg(I, Term, Arg).
+sweep_sub_position(List, list_position(_, _, ElmsPos, TailPos), Sub, Pos) :-
+    sweep_list_sub_position(List, ElmsPos, TailPos, Sub, Pos).
+sweep_sub_position(Dict, dict_position(_, _, _, _, KeyValuePosList), Value, Pos) :-
+    is_dict(Dict),
+    member(key_value_position(_, _, _, _, Key, _, Pos), KeyValuePosList),
+    get_dict(Key, Dict, Value).
+
+sweep_list_sub_position([Elm|_], [Pos|_], _, Elm, Pos).
+sweep_list_sub_position([_|Tail], [_|ElmsPos], TailPos, Sub, Pos) :-
+    sweep_list_sub_position(Tail, ElmsPos, TailPos, Sub, Pos).
+sweep_list_sub_position(Tail, [], TailPos, Tail, TailPos) :-
+    TailPos \== none.
+
+%!  sweep_functor_occurrences(+Spec, -Locations) is det.
+%
+%   Spec is a list [Name, Arity, Files].  Locations is a list of
+%   [File, Line, Column, Text] locations of terms with functor
+%   Name/Arity in Files, where Text is the text of line Line, indexing
+%   files that are not indexed yet in parallel.
+
+sweep_functor_occurrences([Name0, Arity, Files0], Locations) :-
+    term_string(Name, Name0),
+    maplist(atom_string, Files, Files0),
+    concurrent_forall(member(File, Files),
+                      catch(ignore(sweep_functor_index_file(File)), _, true)),
+    with_mutex(sweep_functor_index,
+               findall(File-Begs,
+                       (   member(File, Files),
+                           findall(Beg,
+                                   sweep_functor_occurrence(Name, Arity, File,
+                                                            _, Beg, _),
+                                   Begs0),
+                           Begs0 \== [],
+                           sort(Begs0, Begs)
+                       ),
+                       Occurrences)),
+    foldl(sweep_functor_occurrence_locations, Occurrences, Locations, []).
+
+sweep_functor_occurrence_locations(File-Begs, Locations0, Locations) :-
+    atom_string(File, File0),
+    setup_call_cleanup(prolog_open_source(File, Stream),
+                       read_string(Stream, _, Text),
+                       prolog_close_source(Stream)),
+    split_string(Text, "\n", "", Lines),
+    sweep_offset_lines(Begs, Lines, 1, 0, File0, Locations0, Locations).
+
+sweep_offset_lines([], _, _, _, _, Locations, Locations) :- !.
+sweep_offset_lines(_, [], _, _, _, Locations, Locations) :- !.
+sweep_offset_lines([Beg|Begs], [Line|Lines], N, Offset, File,
+                   Locations0, Locations) :-
+    string_length(Line, Length),
+    Next is Offset + Length + 1,
+    (   Beg < Next
+    ->  Column is Beg - Offset,
+        Locations0 = [[File, N, Column, Line]|Locations1],
+        sweep_offset_lines(Begs, [Line|Lines], N, Offset, File,
+                           Locations1, Locations)
+    ;   N1 is N + 1,
+        sweep_offset_lines([Beg|Begs], Lines, N1, Next, File,
+                           Locations0, Locations)
+    ).
+
+sweep_functor_index_file(File) :-
+    sweep_source_clauses(File, Time, Clauses),
+    sweep_functor_index_ensure(File, Time, Clauses).
+
+sweep_parse_cache_add(Key, Value) :-
+    assertz(sweep_parse_cache(Key, Value)),
+    (   predicate_property(sweep_parse_cache(_, _), number_of_clauses(N)),
+        N > 256
+    ->  once(retract(sweep_parse_cache(_, _)))
+    ;   true
+    ).
 
 sweep_analyze_region([OneTerm,Offset,Contents,Path0], Result) :-
     atom_string(Path, Path0),
@@ -239,10 +655,10 @@ sweep_short_documentation([ClauseString,Point,FileName0], [PIString,Doc,ArgSpan]
     (   FileName0 == []
     ->  Mod = user
     ;   atom_string(FileName, FileName0),
-        xref_source(FileName),
+        sweep_xref(FileName),
         sweep_module_path_(Mod, FileName)
     ),
-    term_string(Clause, ClauseString, [subterm_positions(Pos), module(Mod), syntax_errors(quiet)]),
+    sweep_parse_term(FileName, ClauseString, Clause, Pos, _),
     callable(Clause),
     sweep_short_documentation_clause(Pos, Clause, Point, FileName, Mod, PIString, Doc, ArgSpan).
 
@@ -337,6 +753,38 @@ sweep_short_documentation_head(parentheses_term_position(Beg, End, Pos), Head, N
 sweep_short_documentation_(FileName, Mod, Goal, Index, Meta, PIString, Doc, ArgSpan) :-
     explicit_args(Meta, Goal, Head),
     \+ is_control_goal(Head),
+    sweep_short_documentation_predicate(FileName, Mod, Head, M, PI),
+    sweep_short_documentation_finalize(M, PI, Index, PIString, Doc, ArgSpan).
+
+:- dynamic sweep_eldoc_cache/3.
+
+%!  sweep_short_documentation_predicate(?FileName, +Mod, +Head, -M, -PI) is semidet.
+%
+%   M:PI is the predicate that Head refers to in module Mod of
+%   FileName.  Resolved predicates are cached per modification time
+%   of FileName, since moving point through a clause asks about the
+%   same goals over and over.
+
+sweep_short_documentation_predicate(FileName, Mod, Head, M, PI) :-
+    atom(FileName),
+    !,
+    sweep_source_time(FileName, Time),
+    functor(Head, F, A),
+    Key = predicate(FileName, Mod, F, A),
+    (   Time \== 0,
+        sweep_eldoc_cache(Key, Time, M-PI)
+    ->  true
+    ;   sweep_short_documentation_resolve(FileName, Mod, Head, M, PI),
+        (   Time == 0
+        ->  true
+        ;   retractall(sweep_eldoc_cache(Key, _, _)),
+            assertz(sweep_eldoc_cache(Key, Time, M-PI))
+        )
+    ).
+sweep_short_documentation_predicate(FileName, Mod, Head, M, PI) :-
+    sweep_short_documentation_resolve(FileName, Mod, Head, M, PI).
+
+sweep_short_documentation_resolve(FileName, Mod, Head, M, PI) :-
     (   predicate_property(Mod:Head, built_in)
     ->  M = system
     ;   (   xref_defined(FileName, Head, imported(From))
@@ -355,8 +803,7 @@ sweep_short_documentation_(FileName, Mod, Goal, Index, Meta, PIString, Doc, ArgS
     ->  A is A0 - 2,
         PI = F//A
     ;   PI = F/A0
-    ),
-    sweep_short_documentation_finalize(M, PI, Index, PIString, Doc, ArgSpan).
+    ).
 
 sweep_short_documentation_body(Beg-End, Atom, Neck, Point, FileName, Mod, PIString, Doc, ArgSpan) :-
     !,
@@ -455,6 +902,52 @@ explicit_args_(N, G0, G) :-
     compound_name_arguments(G, F, A).
 
 sweep_short_documentation_finalize(M, PI, Index, PIString, Doc, ArgSpan) :-
+    sweep_signature(M, PI, signature(Doc, ArgSpans)),
+    (   Index == 0
+    ->  ArgSpan = []
+    ;   nth1(Index, ArgSpans, ArgSpan)
+    ),
+    term_string(M:PI, PIString).
+
+%!  sweep_signature(+M, +PI, -Signature) is nondet.
+%
+%   Signature is signature(Doc, ArgSpans), where Doc is the mode line
+%   and summary of M:PI and ArgSpans lists the [Beg|End] span of each
+%   argument in Doc.  M:PI may have several signatures, one for each
+%   mode that its PlDoc comment declares followed by the one from the
+%   manual, so callers can fall back to the next signature if one has
+%   too few arguments.  Signatures are indexed per modification time of
+%   the file that defines M, so ElDoc only renders them once.
+
+sweep_signature(user, PI, Signature) :-
+    % user may span any number of files, so there is no single
+    % modification time to index its signatures by
+    !,
+    sweep_signature_(user, PI, Signature).
+sweep_signature(M, PI, Signature) :-
+    sweep_module_time(M, Time),
+    Key = signature(M, PI),
+    (   sweep_eldoc_cache(Key, Time, Signatures)
+    ->  true
+    ;   findall(Signature0, sweep_signature_(M, PI, Signature0), Signatures),
+        retractall(sweep_eldoc_cache(Key, _, _)),
+        assertz(sweep_eldoc_cache(Key, Time, Signatures))
+    ),
+    member(Signature, Signatures).
+
+%!  sweep_module_time(+M, -Time) is det.
+%
+%   Time is the modification time of the file that defines module M,
+%   or 0 if M has no file.
+
+sweep_module_time(M, Time) :-
+    (   sweep_module_path_(M, File),
+        atom(File)
+    ->  sweep_source_time(File, Time)
+    ;   Time = 0
+    ).
+
+sweep_signature_(M, PI, signature(Doc, ArgSpans)) :-
     doc_comment(M:PI, Pos, OneLiner, Comment),
     is_structured_comment(Comment, Prefixes),
     string_codes(Comment, Codes),
@@ -473,39 +966,16 @@ sweep_short_documentation_finalize(M, PI, Index, PIString, Doc, ArgSpan) :-
     term_string(Mode1, S, [module(pldoc_modes), numbervars(true)]),
     term_string(T    , S, [module(pldoc_modes), numbervars(true),
                            subterm_positions(P), syntax_errors(quiet)]),
-    (   Index == 0
-    ->  ArgSpan = []
-    ;   P = term_position(_, _, _, _, ArgsPos0),
-        (   (   functor(T, '//', 1), PI = _//_
-            ;   functor(T, ':-', 1))
-        ->  ArgsPos0 = [term_position(_, _, _, _, ArgsPos)]
-        ;   ArgsPos = ArgsPos0
-        ),
-        nth1(Index, ArgsPos, ArgPos),
-        pos_bounds(ArgPos, ArgBeg, ArgEnd),
-        ArgSpan = [ArgBeg|ArgEnd]
-    ),
-    format(string(Doc), '~w is ~w.~n    ~w~n', [S, Det, OneLiner]),
-    term_string(M:PI, PIString).
-sweep_short_documentation_finalize(M, PI, Index, PIString, Doc, ArgSpan) :-
+    sweep_signature_arg_spans(T, P, PI, ArgSpans),
+    format(string(Doc), '~w is ~w.~n    ~w~n', [S, Det, OneLiner]).
+sweep_signature_(M, PI, signature(Doc, ArgSpans)) :-
     man_dom(M, PI, Dom),
     memberchk(element(dt, _, SubDom0), Dom),
     memberchk(element(a, Att, SubDom), SubDom0),
     with_output_to(string(S), html_text(element(dt, Att, SubDom))),
     term_string(T , S, [module(pldoc_modes), numbervars(true),
                         subterm_positions(P), syntax_errors(quiet)]),
-    (   Index == 0
-    ->  ArgSpan = []
-    ;   P = term_position(_, _, _, _, ArgsPos0),
-        (   (   functor(T, '//', 1), PI = _//_
-            ;   functor(T, ':-', 1))
-        ->  ArgsPos0 = [term_position(_, _, _, _, ArgsPos)]
-        ;   ArgsPos = ArgsPos0
-        ),
-        nth1(Index, ArgsPos, ArgPos),
-        pos_bounds(ArgPos, ArgBeg, ArgEnd),
-        ArgSpan = [ArgBeg|ArgEnd]
-    ),
+    sweep_signature_arg_spans(T, P, PI, ArgSpans),
     with_output_to(string(DomS), html_text(Dom)),
     (   sub_string(DomS, EOL, _, _, '\n')
     ->  sub_string(DomS, 0, EOL, _, FLine),
@@ -515,9 +985,18 @@ sweep_short_documentation_finalize(M, PI, Index, PIString, Doc, ArgSpan) :-
     ->  sub_string(Rest, 0, EOS, _, OneLiner2)
     ;   OneLiner2=Rest
     ),
-    format(string(Doc), '~w.    ~w.~n', [FLine, OneLiner2]),
-    term_string(M:PI, PIString).
+    format(string(Doc), '~w.    ~w.~n', [FLine, OneLiner2]).
 
+sweep_signature_arg_spans(T, term_position(_, _, _, _, ArgsPos0), PI, ArgSpans) :-
+    !,
+    (   (   functor(T, '//', 1), PI = _//_
+        ;   functor(T, ':-', 1))
+    ->  ArgsPos0 = [term_position(_, _, _, _, ArgsPos)]
+    ;   ArgsPos = ArgsPos0
+    ),
+    maplist([ArgPos, [ArgBeg|ArgEnd]]>>pos_bounds(ArgPos, ArgBeg, ArgEnd),
+            ArgsPos, ArgSpans).
+sweep_signature_arg_spans(_, _, _, []).
 
 :- dynamic man_dom_cache/3.
 
@@ -568,33 +1047,145 @@ sweep_predicate_html_documentation(P0, D) :-
     ->  true
     ;   P1 = PI, M = system
     ),
-    (   (   current_module(M)
-        ;   xref_module(_, M)
-        )
+    sweep_html_documentation(predicate(M, PI), D).
+
+sweep_module_html_documentation(M0, D) :-
+    atom_string(M, M0),
+    sweep_html_documentation(module(M), D).
+
+:- dynamic sweep_html_documentation_cache/3.
+
+%!  sweep_html_documentation(+Key, -HTML) is semidet.
+%
+%   HTML is the rendered documentation of Key, which is either
+%   predicate(M, PI) or module(M).  Rendered pages are cached per
+%   modification time of the file that defines M, except for module
+%   user whose predicates may come from any file.
+
+sweep_html_documentation(Key, D) :-
+    arg(1, Key, user),
+    !,
+    sweep_html_documentation_(Key, D).
+sweep_html_documentation(Key, D) :-
+    arg(1, Key, M),
+    sweep_module_time(M, Time),
+    (   sweep_html_documentation_cache(Key, Time, D0)
     ->  true
-    ;   '$autoload':library_index(_, M, Path),
-        xref_source(Path, [comments(store)])
+    ;   (   sweep_html_documentation_(Key, D1)
+        ->  D0 = D1
+        ;   D0 = none
+        ),
+        retractall(sweep_html_documentation_cache(Key, _, _)),
+        assertz(sweep_html_documentation_cache(Key, Time, D0)),
+        (   predicate_property(sweep_html_documentation_cache(_, _, _),
+                               number_of_clauses(N)),
+            N > 1024
+        ->  once(retract(sweep_html_documentation_cache(_, _, _)))
+        ;   true
+        )
     ),
+    D0 \== none,
+    D = D0.
+
+sweep_html_documentation_(predicate(M, PI), D) :-
+    sweep_html_documentation_module(M),
     (   man_dom(M, PI, DOM)
     ;   doc_comment(M:PI, Pos, _, Comment),
         pldoc_html:pred_dom(M:PI, [], Pos-Comment, DOM)
     ),
     phrase(pldoc_html:html(DOM), HTML),
     with_output_to(string(D), html_write:print_html(HTML)).
+sweep_html_documentation_(module(M), D) :-
+    sweep_html_documentation_module(M),
+    doc_comment(M:module(Desc), Pos, _, Comment),
+    pldoc_html:pred_dom(M:module(Desc), [], Pos-Comment, DOM),
+    phrase(pldoc_html:html(DOM), HTML),
+    with_output_to(string(D), html_write:print_html(HTML)).
 
-sweep_module_html_documentation(M0, D) :-
-    atom_string(M, M0),
+sweep_html_documentation_module(M) :-
     (   (   current_module(M)
         ;   xref_module(_, M)
         )
     ->  true
     ;   '$autoload':library_index(_, M, Path),
-        xref_source(Path, [comments(store)])
+        sweep_xref(Path)
+    ).
+
+%!  sweep_html_documentation_prewarm(+Files, -Thread) is det.
+%
+%   Render the documentation of the modules that Files import, and of
+%   their exported predicates, in a background thread.  The thread
+%   reads the import directives of Files from disk so that it does not
+%   touch the cross reference data of buffers that visit them.
+
+sweep_html_documentation_prewarm(Files0, Id) :-
+    maplist(atom_string, Files, Files0),
+    sweep_create_thread(sweep_html_documentation_prewarm_(Files), T),
+    thread_property(T, id(Id)).
+
+sweep_html_documentation_prewarm_(Files) :-
+    findall(M,
+            (   member(File, Files),
+                catch(sweep_imported_module(File, M), _, fail)
+            ),
+            Ms0),
+    sort(Ms0, Ms),
+    forall(member(M, Ms),
+           catch(sweep_html_documentation_prewarm_module(M), _, true)).
+
+sweep_imported_module(File, M) :-
+    setup_call_cleanup(prolog_open_source(File, Stream),
+                       sweep_read_import_specs(Stream, Specs),
+                       prolog_close_source(Stream)),
+    member(Spec, Specs),
+    absolute_file_name(Spec, Path, [ file_type(prolog),
+                                     access(read),
+                                     relative_to(File),
+                                     file_errors(fail)
+                                   ]),
+    once(sweep_module_path_(M, Path)),
+    M \== user.
+
+sweep_read_import_specs(Stream, Specs) :-
+    (   catch(read_term(Stream, Term, [syntax_errors(quiet)]), _, fail)
+    ->  (   Term == end_of_file
+        ->  Specs = []
+        ;   Term = (:- Directive),
+            sweep_import_directive(Directive, Specs0)
+        ->  append(Specs0, Tail, Specs),
+            sweep_read_import_specs(Stream, Tail)
+        ;   sweep_read_import_specs(Stream, Specs)
+        )
+    ;   sweep_read_import_specs(Stream, Specs)
+    ).
+
+sweep_import_directive(use_module(Specs), List) :-
+    !,
+    sweep_import_spec_list(Specs, List).
+sweep_import_directive(use_module(Spec, _), [Spec]) :- !.
+sweep_import_directive(autoload(Specs), List) :-
+    !,
+    sweep_import_spec_list(Specs, List).
+sweep_import_directive(autoload(Spec, _), [Spec]) :- !.
+sweep_import_directive(reexport(Specs), List) :-
+    sweep_import_spec_list(Specs, List).
+
+sweep_import_spec_list(Specs, Specs) :-
+    is_list(Specs),
+    !.
+sweep_import_spec_list(Spec, [Spec]).
+
+sweep_html_documentation_prewarm_module(M) :-
+    ignore(sweep_html_documentation(module(M), _)),
+    (   module_property(M, exports(Heads))
+    ->  true
+    ;   sweep_module_path_(M, Path),
+        findall(Head, xref_exported(Path, Head), Heads)
     ),
-    doc_comment(M:module(Desc), Pos, _, Comment),
-    pldoc_html:pred_dom(M:module(Desc), [], Pos-Comment, DOM),
-    phrase(pldoc_html:html(DOM), HTML),
-    with_output_to(string(D), html_write:print_html(HTML)).
+    forall(member(Head, Heads),
+           (   pi_head(PI, Head),
+               ignore(sweep_html_documentation(predicate(M, PI), _))
+           )).
 
 sweep_modules_collection([Bef|Aft], Ms) :-
     setof(M, sweep_known_module(M), Ms0),
@@ -713,9 +1304,7 @@ sweep_predicate_apropos(Query0, Matches) :-
 sweep_predicate_location_(H, Path, Line) :-
     xref_defined(Path0, H, How0),
     xref_definition_line(How0, _),
-    xref_source(Path0, [comments(store)]),
-    xref_defined(Path0, H, How),
-    xref_definition_line(How, Line),
+    sweep_definition_line_(Path0, H, Line),
     !,
     atom_string(Path0, Path).
 sweep_predicate_location_(H, Path, Line) :-
@@ -731,17 +1320,13 @@ sweep_predicate_location_(M, H, Path, Line) :-
         xref_definition_line(How0, _),
         xref_module(Path0, M)
     ),
-    xref_source(Path0, [comments(store)]),
-    xref_defined(Path0, H, How),
-    xref_definition_line(How, Line),
+    sweep_definition_line_(Path0, H, Line),
     !,
     atom_string(Path0, Path).
 sweep_predicate_location_(M, H, P, L) :-
     '$autoload':library_index(H, M, P0),
     absolute_file_name(P0, P1, [extensions([pl])]),
-    xref_source(P1, [comments(store)]),
-    xref_defined(P1, H, How),
-    xref_definition_line(How, L),
+    sweep_definition_line_(P1, H, L),
     !,
     atom_string(P1, P).
 sweep_predicate_location_(M, H, Path, Line) :-
@@ -959,18 +1544,86 @@ sweep_path_module(Path0, Module) :-
 
 sweep_setup_message_hook(_, _) :-
     asserta(sweep_main_thread),
+    (   is_message_queue(sweep_messages)
+    ->  true
+    ;   message_queue_create(_, [alias(sweep_messages)])
+    ),
     asserta((
              user:thread_message_hook(Term, Kind, Lines) :-
                  sweep_message_hook(Term, Kind, Lines)
             ),
             Ref),
-    at_halt(erase(Ref)).
-
+    asserta((
+             user:message_hook(Term, Kind, Lines) :-
+                 sweep_thread_message_hook(Term, Kind, Lines)
+            ),
+            Ref1),
+    at_halt((erase(Ref), erase(Ref1))).
+
+%   Messages are queued in sweep_messages and Emacs collects them in
+%   batches with sweep_message_batch/2, after sweep_messages_notify/0
+%   tells it that the queue is not empty.  Messages from the main thread
+%   are only logged, while messages from other threads are logged and
+%   then printed as usual.  At most sweep_message_limit/1 messages are
+%   queued per batch, further messages are only counted.
+
+sweep_message_hook(Term, _, _) :-
+    sweep_message_observe(Term),
+    fail.
 sweep_message_hook(Term, Kind0, _Lines) :-
     should_handle_message_kind(Kind0, Kind),
     !,
-    message_to_string(Term, String),
-    user:sweep_funcall("sweeprolog-message", [Kind|String], _).
+    sweep_message_enqueue(Term, Kind).
+
+sweep_thread_message_hook(Term, Kind0, _Lines) :-
+    \+ sweep_main_thread,
+    ignore(sweep_message_observe(Term)),
+    should_handle_message_kind(Kind0, Kind),
+    sweep_message_enqueue(Term, Kind),
+    fail.
+
+sweep_message_observe(breakpoint(Action, Id)) :-
+    sweep_breakpoint_event(Action, Id).
+
+:- dynamic sweep_message_limit/1.
+
+sweep_message_limit(1000).
+
+sweep_message_enqueue(Term, Kind) :-
+    flag(sweep_messages_queued, Queued, Queued + 1),
+    (   sweep_message_limit(Limit),
+        Queued >= Limit
+    ->  flag(sweep_messages_suppressed, Suppressed, Suppressed + 1)
+    ;   message_to_string(Term, String),
+        thread_send_message(sweep_messages, [Kind|String])
+    ),
+    user:sweep_messages_notify.
+
+%!  sweep_message_batch(+Ignored, -Batch) is det.
+%
+%   Batch is [Suppressed|Messages], where Messages are the messages
+%   that were queued since the last batch, in order, and Suppressed is
+%   the number of further messages that exceeded the limit.
+
+sweep_message_batch(_, [Suppressed|Messages]) :-
+    flag(sweep_messages_queued, _, 0),
+    flag(sweep_messages_suppressed, Suppressed, 0),
+    sweep_message_drain(Messages).
+
+sweep_message_drain(Messages) :-
+    (   is_message_queue(sweep_messages),
+        thread_get_message(sweep_messages, Message, [timeout(0)])
+    ->  Messages = [Message|Tail],
+        sweep_message_drain(Tail)
+    ;   Messages = []
+    ).
+
+sweep_set_message_limit(Limit, _) :-
+    retractall(sweep_message_limit(_)),
+    (   integer(Limit)
+    ->  assertz(sweep_message_limit(Limit))
+    ;   true
+    ).
 
 should_handle_message_kind(error, "error").
 should_handle_message_kind(warning, "warning").
@@ -989,31 +1642,345 @@ sweep_op_info_(Op, _Path, [Type|Pred]) :-
     current_op(Pred, Type0, Op),
     atom_string(Type0, Type).
 
+%!  sweep_op_table(+PathAndGeneration, -Table) is det.
+%
+%   Table is a snapshot of the operators that are in effect in the
+%   source Path, in the order in which sweep_op_info/2 enumerates
+%   them, as a list [Generation|Ops] where each element of Ops is a
+%   list [Op,Type|Precedence].  Generation identifies the snapshot.
+%   If it is equal to the given generation, Table is [] instead.
+
+sweep_op_table([Path0, Generation0], Table) :-
+    atom_string(Path, Path0),
+    findall([Op,Type|Pred],
+            (   sweep_op_info_(Op0, Path, [Type|Pred]),
+                atom(Op0),
+                atom_string(Op0, Op)
+            ),
+            Ops),
+    term_hash(Ops, Generation),
+    (   Generation == Generation0
+    ->  Table = []
+    ;   Table = [Generation|Ops]
+    ).
+
 sweep_source_file_load_time(Path0, Time) :-
     atom_string(Path, Path0),
     source_file_property(Path, modified(Time)).
 
-sweep_load_buffer([String,Modified,Path0], _) :-
+:- dynamic sweep_loaded_buffer/2.
+
+%!  sweep_load_buffer(+Spec, -Result) is semidet.
+%
+%   Spec is [String, Modified, Path, QLF, Skip].  Load String as the
+%   contents of Path.  If Skip is true, skip loading if we already
+%   loaded the same contents for Path and nothing reloaded Path
+%   since.  If QLF is true and String
+%   is the same as the contents of Path on disk, load Path via its
+%   .qlf file, creating or updating it as needed.  Result is
+%   [Status|Seconds], where Status says how we loaded the buffer and
+%   Seconds is the wall time we spent.
+
+sweep_load_buffer([String,Modified,Path0|Rest], [Status|Seconds]) :-
     atom_string(Path, Path0),
-    with_buffer_stream(Stream,
-                       String,
-                       sweep_load_buffer_(Stream, Modified, Path)).
+    variant_sha1(String, Hash),
+    (   Rest = [_, true|_],
+        sweep_loaded_buffer(Path, Hash-Loaded),
+        source_file_property(Path, modified(Loaded))
+    ->  Status = "unchanged",
+        Seconds = 0
+    ;   get_time(Start),
+        sweep_comment_modes_clean(Path),
+        (   Rest = [true|_],
+            sweep_buffer_is_file(String, Path)
+        ->  @(load_files(Path, [qcompile(auto)]), user),
+            Status = "qlf"
+        ;   with_buffer_stream(Stream,
+                               String,
+                               sweep_load_buffer_(Stream, Modified, Path)),
+            Status = "compiled"
+        ),
+        get_time(End),
+        Seconds is End - Start,
+        retractall(sweep_loaded_buffer(Path, _)),
+        (   source_file_property(Path, modified(Loaded))
+        ->  assertz(sweep_loaded_buffer(Path, Hash-Loaded))
+        ;   true
+        )
+    ).
 
 sweep_load_buffer_(Stream, Modified, Path) :-
     set_stream(Stream, file_name(Path)),
     @(load_files(Path, [modified(Modified), stream(Stream)]), user).
 
+:- dynamic sweep_loaded_predicates/4.
+
+%!  sweep_reconsult_buffer(+Spec, -Result) is semidet.
+%
+%   Spec is [String, Modified, Path].  Recompile only the predicates
+%   whose clauses in String differ from the previous call for Path.
+%   If we have no previous clauses for Path, something else reloaded
+%   Path since, the directives of String differ from the previous
+%   version, or a changed predicate is not dynamic, load String in
+%   full instead.  Static predicates go through the reload machinery
+%   of load_files/2, since we cannot erase their clauses.  Result is
+%   [Status, Count|Seconds], where Status is "reconsulted" or
+%   "loaded", Count is the number of recompiled predicates and
+%   Seconds is the wall time we spent.
+
+sweep_reconsult_buffer([String,Modified,Path0], [Status,Count|Seconds]) :-
+    atom_string(Path, Path0),
+    get_time(Start),
+    (   sweep_loaded_predicates(Path, Loaded, Structure0, Hashes0),
+        source_file_property(Path, modified(Loaded)),
+        sweep_module_path_(M, Path),
+        catch(sweep_buffer_predicates(String, Path, M, Structure, Groups),
+              _, fail),
+        Structure == Structure0,
+        catch(sweep_reconsult_predicates(Path, M, Hashes0, Groups,
+                                         Hashes, Count),
+              _, fail)
+    ->  Status = "reconsulted"
+    ;   sweep_load_buffer([String, Modified, Path0, false, false], _),
+        Status = "loaded",
+        Count = 0,
+        sweep_module_path_(M, Path),
+        source_file_property(Path, modified(Loaded)),
+        (   catch(sweep_buffer_predicates(String, Path, M, Structure, Groups),
+                  _, fail)
+        ->  maplist(sweep_predicate_hash, Groups, Hashes)
+        ;   Structure = [], Hashes = []
+        )
+    ),
+    retractall(sweep_loaded_predicates(Path, _, _, _)),
+    (   Hashes == [], Structure == []
+    ->  true
+    ;   assertz(sweep_loaded_predicates(Path, Loaded, Structure, Hashes))
+    ),
+    variant_sha1(String, Hash),
+    retractall(sweep_loaded_buffer(Path, _)),
+    assertz(sweep_loaded_buffer(Path, Hash-Loaded)),
+    get_time(End),
+    Seconds is End - Start.
+
+%!  sweep_buffer_predicates(+String, +Path, +M, -Structure, -Groups) is semidet.
+%
+%   Read and expand the clauses of String in module M.  Groups is a
+%   list of PI-Clauses pairs, where Clauses is a list of Clause-Line
+%   pairs in source order, and Structure is the hash of all other
+%   terms, such as directives.  Fails if String uses conditional
+%   compilation, since we cannot tell which clauses it skips.
+
+sweep_buffer_predicates(String, Path, M, Structure, Groups) :-
+    with_buffer_stream(Stream,
+                       String,
+                       (   set_stream(Stream, file_name(Path)),
+                           sweep_read_expanded(Stream, M, Terms)
+                       )),
+    foldl(sweep_classify_expanded(M), Terms, Pairs0-Others, []-[]),
+    keysort(Pairs0, Pairs),
+    group_pairs_by_key(Pairs, Groups),
+    variant_sha1(Others, Structure).
+
+sweep_read_expanded(Stream, M, Terms) :-
+    read_clause(Stream, Term, [ module(M),
+                                term_position(TermPos),
+                                syntax_errors(error)
+                              ]),
+    (   Term == end_of_file
+    ->  Terms = []
+    ;   \+ sweep_conditional_compilation(Term),
+        stream_position_data(line_count, TermPos, Line),
+        @(expand_term(Term, Expanded0), M),
+        (   is_list(Expanded0)
+        ->  Expanded = Expanded0
+        ;   Expanded = [Expanded0]
+        ),
+        findall(Clause-Line, member(Clause, Expanded), Terms, Tail),
+        sweep_read_expanded(Stream, M, Tail)
+    ).
+
+sweep_conditional_compilation((:- Directive)) :-
+    memberchk(Directive, [if(_), elif(_), else, endif]).
+
+sweep_classify_expanded(M, Clause-Line, Pairs0-Others0, Pairs-Others) :-
+    (   sweep_clause_pi(M, Clause, PI)
+    ->  Pairs0 = [PI-(Clause-Line)|Pairs],
+        Others0 = Others
+    ;   Pairs0 = Pairs,
+        Others0 = [Clause|Others]
+    ).
+
+sweep_clause_pi(M, Clause, PI) :-
+    (   Clause = (Head0 :- _)
+    ->  true
+    ;   Clause = (Head0 => _)
+    ->  true
+    ;   Head0 = Clause
+    ),
+    (   Head0 = M0:Head
+    ->  M0 == M
+    ;   Head = Head0
+    ),
+    callable(Head),
+    \+ Head = (:- _),
+    \+ Head = (?- _),
+    pi_head(PI, Head).
+
+sweep_predicate_hash(PI-Clauses, PI-Hash) :-
+    pairs_keys(Clauses, Terms),
+    variant_sha1(Terms, Hash).
+
+sweep_reconsult_predicates(Path, M, Hashes0, Groups, Hashes, Count) :-
+    maplist(sweep_predicate_hash, Groups, Hashes),
+    findall(PI,
+            (   member(PI-_, Hashes0),
+                \+ memberchk(PI-_, Hashes)
+            ),
+            Deleted),
+    findall(PI-Clauses,
+            (   member(PI-Clauses, Groups),
+                memberchk(PI-Hash, Hashes),
+                \+ memberchk(PI-Hash, Hashes0)
+            ),
+            Changed),
+    forall(member(PI, Deleted), sweep_reconsultable_predicate(M, PI)),
+    forall(member(PI-_, Changed), sweep_reconsultable_predicate(M, PI)),
+    forall(member(PI, Deleted), sweep_erase_predicate(Path, M, PI)),
+    setup_call_cleanup(style_check(-discontiguous),
+                       forall(member(PI-Clauses, Changed),
+                              sweep_recompile_predicate(Path, M, PI, Clauses)),
+                       style_check(+discontiguous)),
+    length(Deleted, NumDeleted),
+    length(Changed, NumChanged),
+    Count is NumDeleted + NumChanged.
+
+sweep_reconsultable_predicate(M, PI) :-
+    pi_head(PI, Head),
+    predicate_property(M:Head, dynamic),
+    \+ predicate_property(M:Head, imported_from(_)).
+
+sweep_erase_predicate(Path, M, PI) :-
+    pi_head(PI, Head),
+    forall(( catch(nth_clause(M:Head, _, Ref), _, fail),
+             clause_property(Ref, file(Path))
+           ),
+           erase(Ref)).
+
+sweep_recompile_predicate(Path, M, PI, Clauses) :-
+    sweep_erase_predicate(Path, M, PI),
+    forall(member(Clause-Line, Clauses),
+           '$store_clause'(M:Clause, _, Path, Path:Line)).
+
+sweep_buffer_is_file(String, Path) :-
+    exists_file(Path),
+    read_file_to_string(Path, Contents, []),
+    Contents == String.
+
 with_buffer_stream(Stream, String, Goal) :-
     setup_call_cleanup(( new_memory_file(H),
                          insert_memory_file(H, 0, String),
                          open_memory_file(H, read, Stream, [encoding(utf8)]),
-                         set_stream(Stream, encoding(utf8))
+                         set_stream(Stream, encoding(utf8)),
+                         asserta(sweep_open_buffer([], Stream, H))
                        ),
                        Goal,
-                       ( close(Stream),
+                       ( retractall(sweep_open_buffer([], Stream, _)),
+                         close(Stream),
                          free_memory_file(H)
                        )).
 
+sweep_memory_report(_, Rows) :-
+    findall(Row, sweep_memory_row(Row), Rows).
+
+sweep_memory_row(["Runtime", Name, Count, Bytes]) :-
+    member(Name-CountKey-BytesKey,
+           [ "Atoms"-atoms-atom_space,
+             "Functors"-functors-functor_space,
+             "Modules"-modules-[],
+             "Predicates"-predicates-[],
+             "Clauses"-clauses-program
+           ]),
+    sweep_statistic(CountKey, Count),
+    sweep_statistic(BytesKey, Bytes).
+sweep_memory_row(["Thread stacks", Name, [], Bytes]) :-
+    thread_property(Id, status(_)),
+    catch(thread_statistics(Id, stack, Bytes), _, fail),
+    term_string(Id, Name).
+sweep_memory_row(["Threads", Name, Count, []]) :-
+    sweep_thread_statistics(_, [Live, Exited, Leaked]),
+    member(Name-Count, ["Live"-Live, "Exited"-Exited, "Leaked"-Leaked]).
+sweep_memory_row(["Xref", Name, Count, []]) :-
+    xref_current_source(Source),
+    aggregate_all(count, xref_defined(Source, _, _), Defined),
+    aggregate_all(count, xref_called(Source, _, _), Called),
+    Count is Defined + Called,
+    sweep_source_name(Source, Name).
+sweep_memory_row(["Comments", Name, Count, Bytes]) :-
+    xref_current_source(Source),
+    aggregate_all(count-sum(Length),
+                  (   (   xref_comment(Source, _, Comment)
+                      ;   xref_comment(Source, _, _, Comment)
+                      ),
+                      string_length(Comment, Length)
+                  ),
+                  Count-Bytes),
+    Count > 0,
+    sweep_source_name(Source, Name).
+sweep_memory_row(["Caches", Name, Count, Bytes]) :-
+    predicate_property(sweep:Head, dynamic),
+    \+ predicate_property(sweep:Head, imported_from(_)),
+    predicate_property(sweep:Head, number_of_clauses(Count)),
+    Count > 0,
+    predicate_property(sweep:Head, size(Bytes)),
+    functor(Head, F, A),
+    format(string(Name), "~w/~w", [F, A]).
+sweep_memory_row(["Comment modes", Name, Count, []]) :-
+    member(Name-Flag, [ "Hits"-sweep_comment_modes_hits,
+                        "Misses"-sweep_comment_modes_misses,
+                        "Evictions"-sweep_comment_modes_evictions
+                      ]),
+    flag(Flag, Count, Count).
+sweep_memory_row(["Memory files", Name, 1, Bytes]) :-
+    sweep_open_buffer(Source, _, H),
+    catch(size_memory_file(H, Bytes, octet), _, Bytes = []),
+    (   Source == []
+    ->  Name = "buffer stream"
+    ;   sweep_source_name(Source, Name)
+    ).
+
+sweep_source_name(Source, Name) :-
+    (   atom(Source)
+    ->  atom_string(Source, Name)
+    ;   term_string(Source, Name)
+    ).
+
+sweep_statistic([], []) :- !.
+sweep_statistic(Key, Value) :-
+    catch(statistics(Key, Value), _, fail),
+    !.
+sweep_statistic(_, []).
+
+sweep_xref_purge(Keep0, Count) :-
+    maplist(atom_string, Keep, Keep0),
+    findall(Source,
+            (   xref_current_source(Source),
+                atom(Source),
+                \+ memberchk(Source, Keep)
+            ),
+            Sources),
+    maplist(sweep_xref_evict, Sources),
+    length(Sources, Count).
+
+sweep_garbage_collect(_, Freed) :-
+    sweep_xref_enforce_limit,
+    statistics(atoms, Atoms0),
+    garbage_collect,
+    garbage_collect_clauses,
+    garbage_collect_atoms,
+    statistics(atoms, Atoms),
+    Freed is max(0, Atoms0 - Atoms).
+
 sweep_imenu_index(Path, Index) :-
     atom_string(Atom, Path),
     findall([String|L],
@@ -1080,7 +2047,8 @@ sweep_top_level_server_loop_(accept(From), ServerSocket) :-
     sweep_top_level_server_loop(ServerSocket).
 sweep_top_level_server_loop_(_, _).
 
-sweep_top_level_client(InStream, OutStream, ip(127,0,0,1)) :-
+sweep_top_level_client(InStream, OutStream, Peer) :-
+    sweep_top_level_trusted_peer(Peer),
     !,
     set_prolog_IO(InStream, OutStream, OutStream),
     set_stream(InStream, tty(true)),
@@ -1109,6 +2077,40 @@ sweep_accept_top_level_client(_, Id) :-
     thread_send_message(sweep_top_level_server, accept(S)),
     thread_get_message(client(Id)).
 
+sweep_top_level_trusted_peer(ip(127,0,0,1)).
+sweep_top_level_trusted_peer(local).
+
+:- dynamic sweep_top_level_local_socket/2.
+
+%!  sweep_top_level_local_server(+Path, -Path) is det.
+%
+%   Listen for top-level connections on a Unix-domain socket at Path.
+%   Emacs creates Path in a private temporary directory, so we trust
+%   any client that connects to it.  Unlike the TCP server, there is
+%   no server thread: Emacs connects before calling
+%   sweep_accept_top_level_local_client/2, so accepting the connection
+%   in the calling thread does not block.
+
+sweep_top_level_local_server(Path, Path) :-
+    sweep_top_level_local_server_stop,
+    unix_domain_socket(ServerSocket),
+    tcp_bind(ServerSocket, Path),
+    tcp_listen(ServerSocket, 5),
+    assertz(sweep_top_level_local_socket(Path, ServerSocket)).
+
+sweep_top_level_local_server_stop :-
+    forall(retract(sweep_top_level_local_socket(_, ServerSocket)),
+           catch(tcp_close_socket(ServerSocket), _, true)).
+
+sweep_accept_top_level_local_client(_, Id) :-
+    sweep_top_level_local_socket(_, ServerSocket),
+    tcp_accept(ServerSocket, Slave, _),
+    tcp_open_socket(Slave, InStream, OutStream),
+    set_stream(InStream, close_on_abort(false)),
+    set_stream(OutStream, close_on_abort(false)),
+    sweep_create_thread(sweep_top_level_client(InStream, OutStream, local), T),
+    thread_property(T, id(Id)).
+
 sweep_thread_signal([ThreadId|Goal0], _) :-
     is_thread(ThreadId),
     term_string(Goal, Goal0),
@@ -1120,7 +2122,7 @@ sweep_local_predicate_export_comment([Path0,F0,A,I0],Comm) :-
     atom_string(I, I0),
     compound_name_arguments(PI, I, [F,A]),
     doc_comment(_:PI, Path:_, _Summary, Comment),
-    sweep_comment_modes(Comment, Modes),
+    sweep_comment_modes(Path, PI, Comment, Modes),
     compound_name_arity(Head, F, A),
     member(ModeAndDet, Modes),
     strip_det(ModeAndDet, Head),
@@ -1183,10 +2185,8 @@ sweep_current_module(Module) :-
 
 sweep_beginning_of_last_predicate(Start, Next) :-
     sweep_source_id(Path),
-    xref_source(Path, [comments(store)]),
     findall(L,
-            (   xref_defined(Path, _, H),
-                xref_definition_line(H, L),
+            (   sweep_definition_line_(Path, _, L),
                 L < Start
             ),
             Ls),
@@ -1195,10 +2195,8 @@ sweep_beginning_of_last_predicate(Start, Next) :-
 
 sweep_beginning_of_next_predicate(Start, Next) :-
     sweep_source_id(Path),
-    xref_source(Path, [comments(store)]),
     findall(L,
-            (   xref_defined(Path, _, H),
-                xref_definition_line(H, L),
+            (   sweep_definition_line_(Path, _, L),
                 Start < L
             ),
             Ls),
@@ -1227,10 +2225,14 @@ sweep_format_compound(F/A, [S|SP]) :-
     !.
 
 sweep_matching_functor(Bef, Aft, F/A) :-
-    current_functor(F, A),
-    atom(F),
-    term_string(F, S),
-    sweep_matching_atom(Bef, Aft, S).
+    sweep_functor_table_ensure,
+    with_mutex(sweep_functor_table,
+               findall(F/A,
+                       (   sweep_functor_known(S, F, A),
+                           sweep_matching_atom(Bef, Aft, S)
+                       ),
+                       Functors)),
+    member(F/A, Functors).
 
 sweep_compound_functors_collection([Arity,Bef,Aft], Fs) :-
     setof(F, sweep_matching_functor(Bef, Aft, F/Arity), Fs0),
@@ -1532,7 +2534,26 @@ sweep_string_to_atom(String, AtomString) :-
            "~W",
            [Atom, [quoted(true), character_escapes(true)]]).
 
+%!  sweep_file_path_in_library(+Path, -Spec) is det.
+%
+%   Spec is a string with the shortest file specification for Path
+%   relative to a file search path alias.  Results are cached until
+%   the definition of file_search_path/2 changes.
+
+:- dynamic sweep_library_spec_cache/3.
+
 sweep_file_path_in_library(Path, Spec) :-
+    predicate_property(user:file_search_path(_, _),
+                       last_modified_generation(Gen)),
+    (   sweep_library_spec_cache(Path, Gen0, Spec0),
+        Gen0 == Gen
+    ->  Spec = Spec0
+    ;   sweep_file_path_in_library_(Path, Spec),
+        retractall(sweep_library_spec_cache(Path, _, _)),
+        assertz(sweep_library_spec_cache(Path, Gen, Spec))
+    ).
+
+sweep_file_path_in_library_(Path, Spec) :-
     file_name_on_path(Path, Spec0),
     prolog_deps:segments(Spec0, Spec1),
     (   string(Spec1)
@@ -1582,20 +2603,92 @@ bind_vars_to_names([N=N|T]) :- bind_vars_to_names(T).
 
 
 predicate_argument_names_from_pldoc(M, PI, Args) :-
-    doc_comment(M:PI, _, _, C),
-    sweep_comment_modes(C, ModeAndDets),
+    doc_comment(M:PI, Pos, _, C),
+    (   Pos = Source:_
+    ->  true
+    ;   Source = M
+    ),
+    sweep_comment_modes(Source, PI, C, ModeAndDets),
     member(ModeAndDet, ModeAndDets),
     strip_det(ModeAndDet, Head),
     Head =.. [_|Args].
 
-:- dynamic comment_modes_cache/2.
+%!  sweep_comment_modes(+Source, +PI, +Comment, -ModeAndDets) is semidet.
+%
+%   ModeAndDets are the modes that the structured Comment of PI in
+%   Source declares.  Results are cached per PI and modification time
+%   of Source, and the cache keeps at most
+%   sweep_comment_modes_cache_limit/1 least recently used entries.
+%   The hits, misses and evictions of this cache appear in the memory
+%   report.
+
+sweep_comment_modes(Source, PI, C, ModeAndDets) :-
+    sweep_source_time(Source, Time),
+    Time \== 0,
+    !,
+    Key = Source-PI,
+    (   with_mutex(sweep_comment_modes,
+                   sweep_comment_modes_hit(Key, Time, Cached))
+    ->  flag(sweep_comment_modes_hits, Hits, Hits + 1)
+    ;   flag(sweep_comment_modes_misses, Misses, Misses + 1),
+        comment_modes(C, Cached),
+        with_mutex(sweep_comment_modes,
+                   sweep_comment_modes_store(Key, Time, Cached)),
+        sweep_comment_modes_enforce_limit
+    ),
+    ModeAndDets = Cached.
+sweep_comment_modes(_, _, C, ModeAndDets) :-
+    comment_modes(C, ModeAndDets).
+
+sweep_comment_modes_hit(Key, Time, Cached) :-
+    sweep_comment_modes_entry(Key, Time, _, Cached),
+    sweep_comment_modes_store(Key, Time, Cached).
+
+sweep_comment_modes_store(Key, Time, Cached) :-
+    flag(sweep_comment_modes_clock, Stamp, Stamp + 1),
+    retractall(sweep_comment_modes_entry(Key, _, _, _)),
+    assertz(sweep_comment_modes_entry(Key, Time, Stamp, Cached)).
+
+sweep_comment_modes_cache_limit(512).
+
+sweep_comment_modes_enforce_limit :-
+    sweep_comment_modes_cache_limit(Max),
+    predicate_property(sweep_comment_modes_entry(_, _, _, _),
+                       number_of_clauses(Count)),
+    Count > Max,
+    !,
+    with_mutex(sweep_comment_modes,
+               sweep_comment_modes_enforce_limit(Max)).
+sweep_comment_modes_enforce_limit.
+
+sweep_comment_modes_enforce_limit(Max) :-
+    % evict down to three quarters of the limit, so that we sort the
+    % entries once per many misses rather than on every miss
+    findall(Stamp-Key,
+            sweep_comment_modes_entry(Key, _, Stamp, _),
+            Pairs0),
+    length(Pairs0, Count),
+    Keep is max(1, Max * 3 // 4),
+    (   Count > Keep
+    ->  keysort(Pairs0, Pairs),
+        Drop is Count - Keep,
+        length(Evict, Drop),
+        append(Evict, _, Pairs),
+        forall(member(Stamp-Key, Evict),
+               retractall(sweep_comment_modes_entry(Key, _, Stamp, _))),
+        flag(sweep_comment_modes_evictions, Evictions, Evictions + Drop)
+    ;   true
+    ).
 
-sweep_comment_modes(C, ModeAndDets) :-
-    comment_modes_cache(C, ModeAndDets),
-    !.
-sweep_comment_modes(C, ModeAndDets) :-
-    comment_modes(C, ModeAndDets),
-    asserta(comment_modes_cache(C, ModeAndDets)).
+sweep_comment_modes_clean(Source) :-
+    with_mutex(sweep_comment_modes,
+               retractall(sweep_comment_modes_entry(Source-_, _, _, _))).
+
+sweep_set_comment_modes_cache_limit(Max, _) :-
+    integer(Max),
+    retractall(sweep_comment_modes_cache_limit(_)),
+    assertz(sweep_comment_modes_cache_limit(Max)),
+    sweep_comment_modes_enforce_limit.
 
 predicate_argument_names_(Arity, Args0, Args) :-
     length(Args0, Arity),
@@ -1607,10 +2700,27 @@ strip_mode_and_type(S, N) => strip_type(S, N).
 strip_type(N:_, N) :- !.
 strip_type(N, N).
 
+%!  sweep_file_missing_dependencies(+File, -Deps) is det.
+%
+%   Deps is a list of [Path, PI, Kind, Spec] descriptors of the
+%   dependency directives that File lacks, where Spec is the library
+%   specification of Path.  Deps is computed once per modification
+%   time of File and kept until File changes or its cross reference
+%   data is evicted.
+
+:- dynamic sweep_dependencies_cache/3.
+
 sweep_file_missing_dependencies(File0, Deps) :-
     atom_string(File, File0),
-    file_autoload_directives(File, Directives, [missing(true)]),
-    phrase(dep_directives(Directives), Deps).
+    sweep_source_time(File, Time),
+    (   sweep_dependencies_cache(File, Time, Deps0)
+    ->  Deps = Deps0
+    ;   sweep_xref(File),
+        file_autoload_directives(File, Directives, [missing(true)]),
+        phrase(dep_directives(Directives), Deps),
+        retractall(sweep_dependencies_cache(File, _, _)),
+        assertz(sweep_dependencies_cache(File, Time, Deps))
+    ).
 
 dep_directives(Directives) --> sequence(dep_directive, Directives).
 
@@ -1624,9 +2734,10 @@ dep_directive(:- use_module(Spec)) -->
                            [ file_type(prolog),
                              access(read)
                            ]),
-           atom_string(Path0, Path)
+           atom_string(Path0, Path),
+           sweep_file_path_in_library(Path0, LibSpec)
     },
-    [[Path, [], "use_module"]].
+    [[Path, [], "use_module", LibSpec]].
 dep_directive(:- Directive) -->
     {   compound_name_arguments(Directive, Kind0, [Spec, ImportList]),
         atom_string(Kind0, Kind),
@@ -1634,14 +2745,15 @@ dep_directive(:- Directive) -->
                            [ file_type(prolog),
                              access(read)
                            ]),
-        atom_string(Path0, Path)
+        atom_string(Path0, Path),
+        sweep_file_path_in_library(Path0, LibSpec)
     },
-    sequence(dep_import(Path, Kind), ImportList).
+    sequence(dep_import(Path, Kind, LibSpec), ImportList).
 
-dep_import(Path, Kind, PI0) -->
+dep_import(Path, Kind, LibSpec, PI0) -->
     {   term_string(PI0, PI)
     },
-    [[Path, PI, Kind]].
+    [[Path, PI, Kind, LibSpec]].
 
 
 sweep_format_head([M0,F0,A,D], [S|SP]) :-
@@ -1671,14 +2783,157 @@ sweep_current_functors(A0, Col) :-
     ->  true
     ;   A = A0
     ),
-    findall([F|A],
-            (   current_functor(F0, A),
-                atom(F0),
-                term_string(F0, F)
+    sweep_functor_table_ensure,
+    with_mutex(sweep_functor_table,
+               findall([F|A], sweep_functor_known(F, _, A), Col)).
+
+%!  sweep_functors_page(+Spec, -Page) is det.
+%
+%   Spec is [Prefix, Arity, Offset, Limit].  Page is [Next|Functors],
+%   where Functors are at most Limit [Name|Arity] pairs, starting
+%   from the Offset-th functor whose quoted name starts with Prefix
+%   and whose arity is Arity, or any arity if Arity is [].  Next is
+%   the offset of the following page, or [] if this is the last one.
+
+sweep_functors_page([Prefix, Arity, Offset, Limit], [Next|Functors]) :-
+    sweep_functor_table_ensure,
+    Limit1 is Limit + 1,
+    End is Offset + Limit1,
+    with_mutex(sweep_functor_table,
+               (   sweep_functor_table_size(_, Count),
+                   sweep_functor_lower_bound(Prefix, 1, Count, Start),
+                   findall(Functor,
+                           limit(End,
+                                 sweep_functor_match(Start, Count,
+                                                     Prefix, Arity,
+                                                     Functor)),
+                           Indexed),
+                   findall([S|A],
+                           (   sweep_functor_recent(S, _, A),
+                               sub_string(S, 0, _, _, Prefix),
+                               (   Arity == []
+                               ->  true
+                               ;   A == Arity
+                               )
+                           ),
+                           Recent)
+               )),
+    append(Indexed, Recent, Matches0),
+    msort(Matches0, Matches),
+    findall(Functor,
+            limit(Limit1, offset(Offset, member(Functor, Matches))),
+            Functors0),
+    (   length(Functors, Limit),
+        append(Functors, [_], Functors0)
+    ->  Next is Offset + Limit
+    ;   Functors = Functors0,
+        Next = []
+    ).
+
+sweep_functor_lower_bound(Prefix, Lo, Hi, I) :-
+    (   Lo > Hi
+    ->  I = Lo
+    ;   Mid is (Lo + Hi) // 2,
+        sweep_functor_entry(Mid, S, _, _),
+        (   S @< Prefix
+        ->  Lo1 is Mid + 1,
+            sweep_functor_lower_bound(Prefix, Lo1, Hi, I)
+        ;   Hi1 is Mid - 1,
+            sweep_functor_lower_bound(Prefix, Lo, Hi1, I)
+        )
+    ).
+
+sweep_functor_match(I, Count, Prefix, Arity, Functor) :-
+    I =< Count,
+    sweep_functor_entry(I, S, _, A),
+    sub_string(S, 0, _, _, Prefix),
+    (   (   Arity == []
+        ->  true
+        ;   A == Arity
+        ),
+        Functor = [S|A]
+    ;   I1 is I + 1,
+        sweep_functor_match(I1, Count, Prefix, Arity, Functor)
+    ).
+
+%   The functor table holds the quoted names of functors in standard
+%   order, numbered from 1, so we can binary search it for a prefix.
+%   When the number of functors in the system changes, we add the new
+%   functors to a small unsorted table of recent functors, and only
+%   rebuild the sorted table once the recent table grows beyond an
+%   eighth of it.  Updates and readers take the sweep_functor_table
+%   mutex, so readers never see a partially updated table.
+
+:- dynamic sweep_functor_entry/4,
+           sweep_functor_recent/3,
+           sweep_functor_table_size/2.
+
+sweep_functor_known(S, F, A) :-
+    sweep_functor_entry(_, S, F, A).
+sweep_functor_known(S, F, A) :-
+    sweep_functor_recent(S, F, A).
+
+sweep_functor_table_ensure :-
+    statistics(functors, N),
+    (   with_mutex(sweep_functor_table, sweep_functor_table_size(N, _))
+    ->  true
+    ;   with_mutex(sweep_functor_table, sweep_functor_table_update(N))
+    ).
+
+sweep_functor_table_update(N) :-
+    sweep_functor_table_size(N, _),
+    !.
+sweep_functor_table_update(N) :-
+    sweep_functor_table_size(_, Count),
+    !,
+    findall(S-(F/A),
+            (   current_functor(F, A),
+                atom(F),
+                \+ sweep_functor_entry(_, _, F, A),
+                \+ sweep_functor_recent(_, F, A),
+                term_string(F, S)
             ),
-            Col).
+            New),
+    forall(member(S-(F/A), New),
+           assertz(sweep_functor_recent(S, F, A))),
+    (   predicate_property(sweep_functor_recent(_, _, _),
+                           number_of_clauses(Recent)),
+        Recent > 1024 + Count // 8
+    ->  findall(S-(F/A), sweep_functor_known(S, F, A), Pairs0),
+        msort(Pairs0, Pairs),
+        sweep_functor_table_rebuild(N, Pairs)
+    ;   retractall(sweep_functor_table_size(_, _)),
+        assertz(sweep_functor_table_size(N, Count))
+    ).
+sweep_functor_table_update(N) :-
+    findall(S-(F/A),
+            (   current_functor(F, A),
+                atom(F),
+                term_string(F, S)
+            ),
+            Pairs0),
+    msort(Pairs0, Pairs),
+    sweep_functor_table_rebuild(N, Pairs).
+
+sweep_functor_table_rebuild(N, Pairs) :-
+    retractall(sweep_functor_entry(_, _, _, _)),
+    retractall(sweep_functor_recent(_, _, _)),
+    foldl(sweep_functor_table_add, Pairs, 0, Count),
+    retractall(sweep_functor_table_size(_, _)),
+    assertz(sweep_functor_table_size(N, Count)).
+
+sweep_functor_table_add(S-(F/A), I0, I) :-
+    I is I0 + 1,
+    assertz(sweep_functor_entry(I, S, F, A)).
+
+sweep_term_replace([FileName0,BodyIndent|Spec], Res) :-
+    sweep_term_replace_spec(Spec, TemplateGoal, Final, RepVarNames),
+    atom_string(FileName, FileName0),
+    sweep_xref(FileName),
+    sweep_term_replace_file(FileName, BodyIndent, Final, TemplateGoal, RepVarNames, Res).
 
-sweep_term_replace([FileName0,BodyIndent,TemplateString,GoalString,FinalString,RepString], Res) :-
+sweep_term_replace_spec([TemplateString,GoalString,FinalString,RepString],
+                        Template-Goal, Final, Rep-VarNames0) :-
     term_string(Template, TemplateString, [variable_names(TemplateVarNames)]),
     term_string(Goal, GoalString, [variable_names(GoalVarNames)]),
     maplist(term_string, Final, FinalString),
@@ -1686,13 +2941,153 @@ sweep_term_replace([FileName0,BodyIndent,TemplateString,GoalString,FinalString,R
     maplist({GoalVarNames}/[VarName]>>ignore(memberchk(VarName, GoalVarNames)),
             TemplateVarNames),
     maplist({VarNames0}/[VarName]>>ignore(memberchk(VarName, VarNames0)),
-            TemplateVarNames),
-    atom_string(FileName, FileName0),
-    xref_source(FileName),
+            TemplateVarNames).
+
+sweep_term_replace_file(FileName, BodyIndent, Final, Template-Goal, RepVarNames, Res) :-
     sweep_module_path_(Module, FileName),
-    setup_call_cleanup(prolog_open_source(FileName, Stream),
-                       sweep_replace_stream(Stream, FileName, Module, BodyIndent, Final, Template-Goal, Rep-VarNames0, Res),
-                       prolog_close_source(Stream)).
+    sweep_source_clauses(FileName, Time, Clauses0),
+    sweep_replace_candidates(FileName, Time, Template, Clauses0, Clauses),
+    sweep_replace_clauses(Clauses, FileName, Module, BodyIndent, Final, Template-Goal, RepVarNames, Res).
+
+%!  sweep_replace_candidates(+Source, +Time, +Template, +Clauses0, -Clauses) is det.
+%
+%   Clauses are the elements of Clauses0 that may contain a term that
+%   Template subsumes, according to the functor occurrence index of
+%   Source if Template is callable.
+
+sweep_replace_candidates(Source, Time, Template, Clauses0, Clauses) :-
+    callable(Template),
+    sweep_functor_index_ensure(Source, Time, Clauses0),
+    functor(Template, Name, Arity),
+    with_mutex(sweep_functor_index,
+               (   sweep_functor_index(Source, Time),
+                   findall(I,
+                           (   sweep_functor_occurrence(Name, Arity, Source,
+                                                        I, _, _)
+                           ;   sweep_functor_index_qq(Source, I)
+                           ),
+                           Is0)
+               )),
+    !,
+    sort(Is0, Is),
+    sweep_select_numbered(Is, 1, Clauses0, Clauses).
+sweep_replace_candidates(_, _, Template, Clauses0, Clauses) :-
+    include(sweep_replace_candidate(Template), Clauses0, Clauses).
+
+sweep_select_numbered([], _, _, []) :- !.
+sweep_select_numbered([I|Is], I, [Clause|Clauses0], [Clause|Clauses]) :-
+    !,
+    J is I + 1,
+    sweep_select_numbered(Is, J, Clauses0, Clauses).
+sweep_select_numbered(Is, I, [_|Clauses0], Clauses) :-
+    J is I + 1,
+    sweep_select_numbered(Is, J, Clauses0, Clauses).
+
+%!  sweep_replace_candidate(+Template, +Clause) is semidet.
+%
+%   True when Clause may contain a term that Template subsumes, judging
+%   by the name and arity of Template.  This is much cheaper than
+%   walking the subterm positions of Clause.
+
+sweep_replace_candidate(Template, _) :-
+    var(Template),
+    !.
+sweep_replace_candidate(_, clause(_, Pos, _)) :-
+    sub_term(QQPos, Pos),
+    compound(QQPos),
+    QQPos = quasi_quotation_position(_, _, _, _, _),
+    !.
+sweep_replace_candidate(Template, clause(Term, _, _)) :-
+    functor(Template, Name, Arity),
+    sub_term(Sub, Term),
+    nonvar(Sub),
+    functor(Sub, Name, Arity),
+    !.
+
+%!  sweep_project_replace_start(+Spec, -Id) is det.
+%
+%   Register a project-wide replacement job Id for the files and
+%   replacement specification in Spec.  The job runs in the async goal
+%   sweep_project_replace_run(Id).
+
+sweep_project_replace_start([Files0,BodyIndent|Spec], Id) :-
+    maplist(atom_string, Files, Files0),
+    flag(sweep_project_replace, Id, Id + 1),
+    assertz(sweep_project_replace_job(Id, Files, BodyIndent, Spec)).
+
+sweep_project_replace_files(Id, Files) :-
+    findall(File0,
+            (   sweep_project_replace_match(Id, File),
+                atom_string(File, File0)
+            ),
+            Files).
+
+sweep_project_replace_done(Id, _) :-
+    retractall(sweep_project_replace_job(Id, _, _, _)),
+    retractall(sweep_project_replace_match(Id, _)).
+
+%!  sweep_project_replace_run(+Id) is det.
+%
+%   Search the files of job Id on a pool of worker threads, and print
+%   a line for each match in the format of compilation messages.
+
+sweep_project_replace_run(Id) :-
+    sweep_project_replace_job(Id, Files, BodyIndent, Spec),
+    retractall(sweep_project_replace_match(Id, _)),
+    current_output(Out),
+    concurrent_forall(member(File, Files),
+                      sweep_project_replace_file(Id, Out, BodyIndent, Spec, File)),
+    aggregate_all(count, sweep_project_replace_match(Id, _), Count),
+    length(Files, Total),
+    format("~nMatches found in ~D of ~D files~n", [Count, Total]).
+
+sweep_project_replace_file(Id, Out, BodyIndent, Spec, File) :-
+    catch(sweep_project_replace_file_(Id, Out, BodyIndent, Spec, File),
+          Error,
+          format(Out, "~w:1: ~p~n", [File, Error])).
+
+sweep_project_replace_file_(Id, Out, BodyIndent, Spec, File) :-
+    sweep_term_replace_spec(Spec, Template-Goal, Final, RepVarNames),
+    read_file_to_string(File, Text, []),
+    sweep_replace_candidate_text(Template, Text),
+    sweep_xref(File),
+    sweep_term_replace_file(File, BodyIndent, Final, Template-Goal, RepVarNames, Res),
+    Res = [_|_],
+    !,
+    assertz(sweep_project_replace_match(Id, File)),
+    forall(member(replace(Beg, End, New), Res),
+           (   sweep_offset_line_column(Text, Beg, Line, Col),
+               Len is End - Beg,
+               sub_string(Text, Beg, Len, _, Old0),
+               normalize_space(string(Old), Old0),
+               normalize_space(string(Rep), New),
+               format(Out, "~w:~d:~d: ~s  =>  ~s~n", [File, Line, Col, Old, Rep])
+           )).
+sweep_project_replace_file_(_, _, _, _, _).
+
+%   Files that do not mention the name of the template cannot match,
+%   unless the name is not an identifier that appears literally in the
+%   source text.
+
+sweep_replace_candidate_text(Template, Text) :-
+    (   nonvar(Template),
+        functor(Template, Name, _),
+        atom(Name),
+        atom_codes(Name, [C|Cs]),
+        code_type(C, csymf),
+        forall(member(C1, Cs), code_type(C1, csym))
+    ->  sub_string(Text, _, _, _, Name),
+        !
+    ;   true
+    ).
+
+sweep_offset_line_column(Text, Offset, Line, Column) :-
+    sub_string(Text, 0, Offset, _, Before),
+    split_string(Before, "\n", "", Lines),
+    length(Lines, Line),
+    last(Lines, Last),
+    string_length(Last, Column0),
+    Column is Column0 + 1.
 
 sweep_anon_var_names(Term, VarNames, AnonVars) :-
     term_variables(Term, TermVars),
@@ -1702,27 +3097,14 @@ sweep_anon_var_names(Term, VarNames, AnonVars) :-
                                        ),
              TermVars, AnonVars).
 
-sweep_replace_stream(Stream, FileName, Module, BodyIndent, Final, TemplateGoal, Rep-VarNames0, Res) :-
-    read_clause(Stream, Term, [subterm_positions(Pos), variable_names(VarNames1), syntax_errors(dec10)]),
-    !,
+sweep_replace_clauses([], _, _, _, _, _, _, []).
+sweep_replace_clauses([clause(Term, Pos, VarNames1)|Clauses], FileName, Module, BodyIndent, Final, TemplateGoal, Rep-VarNames0, Res) :-
     sweep_anon_var_names(Rep, VarNames0, AnonVars0),
     sweep_anon_var_names(Term, VarNames1, AnonVars1),
     maplist(var_name_disambiguate(VarNames1), VarNames0, VarNames2),
     append(AnonVars1, AnonVars0, AnonVars),
     append(VarNames2, AnonVars, VarNames3),
     append(VarNames1, VarNames3, VarNames),
-    sweep_replace_stream_(Term, Pos, Stream, FileName, Module, BodyIndent, Final, TemplateGoal, VarNames0, Rep-VarNames, Res).
-sweep_replace_stream(Stream, FileName, Module, BodyIndent, Final, TemplateGoal, RepVarNames, Res) :-
-    sweep_replace_stream(Stream, FileName, Module, BodyIndent, Final, TemplateGoal, RepVarNames, Res).
-
-var_name_disambiguate(VarNames1, Name0=Var, Name=Var) :-
-    (   member(Name0=_, VarNames1)
-    ->  atom_concat(Name0, 'Fresh', Name)
-    ;   Name = Name0
-    ).
-
-sweep_replace_stream_(end_of_file, _, _, _, _, _, _, _, _, _, []) :- !.
-sweep_replace_stream_(Term, Pos, Stream, FileName, Module, BodyIndent, Final, TemplateGoal, VarNames0, Rep-VarNames, Res) :-
     (   var(Term)
     ->  State = clause
     ;   memberchk(Term, [(_:-_),(_=>_),(_-->_)])
@@ -1735,8 +3117,13 @@ sweep_replace_stream_(Term, Pos, Stream, FileName, Module, BodyIndent, Final, Te
             sweep_replace_term(Pos, Term, FileName, Module, BodyIndent, 0, 1200, State, Final, TemplateGoal, Rep-VarNames,Result),
             Res,
             Tail),
-    sweep_replace_stream(Stream, FileName, Module, BodyIndent, Final, TemplateGoal, Rep-VarNames0, Tail).
+    sweep_replace_clauses(Clauses, FileName, Module, BodyIndent, Final, TemplateGoal, Rep-VarNames0, Tail).
 
+var_name_disambiguate(VarNames1, Name0=Var, Name=Var) :-
+    (   member(Name0=_, VarNames1)
+    ->  atom_concat(Name0, 'Fresh', Name)
+    ;   Name = Name0
+    ).
 
 %!  sweep_replace_term(Pos, Term, FileName, Module, BodyIndent, CurrentIndent, Precedence, State, Final, TemplateGoal, RepVarNames, Result) is nondet.
 
@@ -1909,29 +3296,11 @@ list_tail([_|T0], T) :- nonvar(T0), T0 = [_|_], !, list_tail(T0, T).
 list_tail([_|T], T).
 
 sweep_terms_at_point([String, Start, Point], Res) :-
-    (   sweep_source_id(Path),
-        findall(Op, xref_op(Path, Op), Ops),
-        (   xref_module(Path, Module)
-        ->  true
-        ;   Module = user
-        )
-    ->  true
-    ;   Module = user, Ops = []
-    ),
-    with_buffer_stream(
-        Stream,
-        String,
-        (   ignore((   nonvar(Path),
-                       set_stream(Stream, file_name(Path))
-                   )),
-            read_source_term_at_location(Stream, _,
-                                         [module(Module),
-                                          operators(Ops),
-                                          subterm_positions(SubPos)]),
-            findall([Beg|End],
-                    sweep_terms_at_point_(SubPos, Start, Point, Beg, End),
-                    Res)
-        )).
+    ignore(sweep_source_id(Path)),
+    sweep_parse_term(Path, String, _, SubPos, _),
+    findall([Beg|End],
+            sweep_terms_at_point_(SubPos, Start, Point, Beg, End),
+            Res).
 
 sweep_terms_at_point_(SubPos, Start, Point, Beg, End) :-
     SubPos \= parentheses_term_position(_, _, _),
@@ -1961,19 +3330,376 @@ pos_bounds(SubPos, Beg0, End0) :-
     arg(1, SubPos, Beg0),
     arg(2, SubPos, End0).
 
+%!  sweep_term_tokens(+StringAndStart, -Tokens) is semidet.
+%
+%   Tokens is a list of the tokens of the term that String holds, as
+%   determined by the subterm positions that the Prolog reader reports,
+%   in the format of sweeprolog-next-token-boundaries.  Each element is
+%   a list [Kind,Beg,End], where Kind is one of "symbol", "functor",
+%   "string", "operator", "open", "close" and "else", and Beg and End
+%   are buffer positions, given that String starts at buffer position
+%   Start.  Fails if String does not hold a syntactically valid term.
+%
+%   Tokens are split the way sweeprolog-next-token-boundaries scans
+%   them, so both agree: a quoted functor name is a string followed by
+%   an opening parenthesis, and a negative number is a minus operator
+%   followed by a symbol.
+
+sweep_term_tokens([String, Start], Tokens) :-
+    ignore(sweep_source_id(Path)),
+    sweep_parse_term(Path, String, _, SubPos, _),
+    phrase(sweep_pos_tokens(SubPos, String), Tokens0, Tokens1),
+    pos_bounds(SubPos, _, End),
+    sweep_skip_layout(String, End, Dot),
+    (   sweep_char_at(String, Dot, 0'.)
+    ->  Dot1 is Dot + 1,
+        Tokens1 = [tok(Dot, Dot1, operator)]
+    ;   Tokens1 = []
+    ),
+    msort(Tokens0, Tokens2),
+    maplist(sweep_token_offset(Start), Tokens2, Tokens).
+
+sweep_token_offset(Start, tok(Beg0, End0, Kind0), [Kind,Beg,End]) :-
+    atom_string(Kind0, Kind),
+    Beg is Beg0 + Start,
+    End is End0 + Start.
+
+sweep_pos_tokens(From-To, Text) -->
+    !,
+    sweep_leaf_tokens(From, To, Text).
+sweep_pos_tokens(string_position(From, To), _) -->
+    !,
+    [tok(From, To, string)].
+sweep_pos_tokens(brace_term_position(From, To, Arg), Text) -->
+    !,
+    sweep_open_close_tokens(From, To),
+    sweep_pos_tokens(Arg, Text).
+sweep_pos_tokens(list_position(From, To, Elms, Tail), Text) -->
+    !,
+    sweep_open_close_tokens(From, To),
+    sweep_args_tokens(Elms, Text),
+    (   {Tail == none}
+    ->  []
+    ;   {last(Elms, Last)},
+        sweep_separator_token(Last, Text),
+        sweep_pos_tokens(Tail, Text)
+    ).
+sweep_pos_tokens(term_position(From, To, FFrom, FTo, Args), Text) -->
+    {   FFrom == From,
+        sweep_char_at(Text, FTo, 0'()
+    },
+    !,
+    {   FTo1 is FTo + 1,
+        To0 is To - 1
+    },
+    (   {   sweep_char_at(Text, From, Q),
+            memberchk(Q, [0'\', 0'"])
+        }
+    ->  [tok(From, FTo, string), tok(FTo, FTo1, open)]
+    ;   [tok(From, FTo1, functor)]
+    ),
+    [tok(To0, To, close)],
+    sweep_args_tokens(Args, Text).
+sweep_pos_tokens(term_position(_, _, FFrom, FTo, Args), Text) -->
+    !,
+    sweep_leaf_tokens(FFrom, FTo, Text),
+    sweep_pos_list_tokens(Args, Text).
+sweep_pos_tokens(parentheses_term_position(From, To, Inner), Text) -->
+    !,
+    sweep_open_close_tokens(From, To),
+    sweep_pos_tokens(Inner, Text).
+sweep_pos_tokens(dict_position(_, To, TagFrom, TagTo, KVs), Text) -->
+    !,
+    [tok(TagFrom, TagTo, symbol)],
+    sweep_open_close_tokens(TagTo, To),
+    sweep_key_values_tokens(KVs, Text).
+sweep_pos_tokens(Pos, _) -->
+    {   pos_bounds(Pos, From, To)   },
+    [tok(From, To, else)].
+
+sweep_pos_list_tokens([], _) --> [].
+sweep_pos_list_tokens([H|T], Text) -->
+    sweep_pos_tokens(H, Text),
+    sweep_pos_list_tokens(T, Text).
+
+sweep_args_tokens([], _) --> [].
+sweep_args_tokens([H|T], Text) -->
+    sweep_pos_tokens(H, Text),
+    (   {T == []}
+    ->  []
+    ;   sweep_separator_token(H, Text),
+        sweep_args_tokens(T, Text)
+    ).
+
+sweep_key_values_tokens([], _) --> [].
+sweep_key_values_tokens([key_value_position(_, _, SFrom, STo, _, KeyPos, ValuePos)|T], Text) -->
+    sweep_pos_tokens(KeyPos, Text),
+    [tok(SFrom, STo, operator)],
+    sweep_pos_tokens(ValuePos, Text),
+    (   {T == []}
+    ->  []
+    ;   sweep_separator_token(ValuePos, Text),
+        sweep_key_values_tokens(T, Text)
+    ).
+
+sweep_open_close_tokens(From, To) -->
+    {   From1 is From + 1,
+        To0 is To - 1
+    },
+    [tok(From, From1, open), tok(To0, To, close)].
+
+sweep_separator_token(Pos, Text) -->
+    {   pos_bounds(Pos, _, End),
+        sweep_skip_layout(Text, End, Sep),
+        Sep1 is Sep + 1
+    },
+    [tok(Sep, Sep1, operator)].
+
+sweep_leaf_tokens(From, To, Text) -->
+    {   To =:= From + 2,
+        sub_string(Text, From, 2, _, Pair),
+        memberchk(Pair, ["[]", "{}"])
+    },
+    !,
+    sweep_open_close_tokens(From, To).
+sweep_leaf_tokens(From, To, Text) -->
+    {   sweep_char_at(Text, From, 0'-),
+        From1 is From + 1,
+        From1 < To,
+        sweep_char_at(Text, From1, D),
+        code_type(D, digit)
+    },
+    !,
+    [tok(From, From1, operator), tok(From1, To, symbol)].
+sweep_leaf_tokens(From, To, Text) -->
+    {   sweep_char_at(Text, From, C),
+        sweep_leaf_kind(C, Kind)
+    },
+    [tok(From, To, Kind)].
+
+sweep_leaf_kind(C, string) :-
+    memberchk(C, [0'", 0'\', 0'`]),
+    !.
+sweep_leaf_kind(C, operator) :-
+    string_codes("#$&*+-./:<=>?@^~\\|,;", Codes),
+    memberchk(C, Codes),
+    !.
+sweep_leaf_kind(_, symbol).
+
+sweep_char_at(Text, Offset, C) :-
+    Index is Offset + 1,
+    string_code(Index, Text, C).
+
+sweep_skip_layout(Text, Pos0, Pos) :-
+    (   sweep_char_at(Text, Pos0, C)
+    ->  (   code_type(C, space)
+        ->  Pos1 is Pos0 + 1,
+            sweep_skip_layout(Text, Pos1, Pos)
+        ;   C == 0'%
+        ->  sweep_skip_past(Text, Pos0, "\n", Pos1),
+            sweep_skip_layout(Text, Pos1, Pos)
+        ;   C == 0'/,
+            Pos2 is Pos0 + 1,
+            sweep_char_at(Text, Pos2, 0'*)
+        ->  Pos3 is Pos2 + 1,
+            sweep_skip_past(Text, Pos3, "*/", Pos1),
+            sweep_skip_layout(Text, Pos1, Pos)
+        ;   Pos = Pos0
+        )
+    ;   Pos = Pos0
+    ).
+
+sweep_skip_past(Text, Pos0, Sub, Pos) :-
+    sub_string(Text, Pos0, _, 0, Rest),
+    (   once(sub_string(Rest, Before, Length, _, Sub))
+    ->  Pos is Pos0 + Before + Length
+    ;   string_length(Text, Pos)
+    ).
+
 sweep_predicate_dependencies([To0|From0], Deps) :-
     atom_string(To, To0),
     atom_string(From, From0),
-    setof(PI,
-          PI0^Head^By^(
-                          xref_defined(To, Head, imported(From)),
-                          xref_called(To, Head, By),
-                          pi_head(PI0, Head),
-                          term_string(PI0, PI)
-                      ),
-          Deps).
+    sweep_dependency_graph_update(To),
+    sweep_dependency_edge(To, From, Deps),
+    Deps \== [].
+
+%!  sweep_unused_dependencies(+File, -Paths) is det.
+%
+%   Paths are the files that File depends on without calling any of
+%   their predicates.  Files that export operators or define term or
+%   goal expansion hooks affect File without being called, so they
+%   are not included.
+
+sweep_unused_dependencies(File0, Paths) :-
+    atom_string(File, File0),
+    sweep_dependency_graph_update(File),
+    findall(Path,
+            (   sweep_dependency_edge(File, Path0, []),
+                \+ sweep_dependency_side_effects(Path0),
+                atom_string(Path0, Path)
+            ),
+            Paths).
+
+sweep_dependency_side_effects(Path) :-
+    sweep_dependency_exports_ops(Path),
+    !.
+sweep_dependency_side_effects(Path) :-
+    sweep_dependency_expansion_hook(Hook),
+    (   member(M, [user, system]),
+        catch(clause(M:Hook, _, Ref), _, fail),
+        clause_property(Ref, file(Path))
+    ;   xref_defined(Path, _:Hook, _)
+    ;   xref_defined(Path, Hook, _)
+    ),
+    !.
+
+sweep_dependency_exports_ops(Path) :-
+    module_property(M, file(Path)),
+    module_property(M, exported_operators([_|_])),
+    !.
+sweep_dependency_exports_ops(Path) :-
+    catch(xref_public_list(Path, Path, [exports(Exports)]), _, fail),
+    memberchk(op(_, _, _), Exports).
+
+sweep_dependency_expansion_hook(term_expansion(_, _)).
+sweep_dependency_expansion_hook(term_expansion(_, _, _, _)).
+sweep_dependency_expansion_hook(goal_expansion(_, _)).
+sweep_dependency_expansion_hook(goal_expansion(_, _, _, _)).
+
+%!  sweep_dependency_cycles(+Root, -Cycles) is det.
+%
+%   Cycles is a list of the strongly connected components of the
+%   dependency graph that contain a cycle, restricted to files under
+%   the directory Root, or to all known files if Root is [].  Each
+%   component is a sorted list of file names.
+
+sweep_dependency_cycles(Root, Cycles) :-
+    sweep_dependency_graph_refresh,
+    findall(From-To, sweep_dependency_graph_edge(Root, From, To, _), Edges),
+    vertices_edges_to_ugraph([], Edges, Graph),
+    transitive_closure(Graph, Closure),
+    findall(Cycle,
+            (   member(V-Reach, Closure),
+                memberchk(V, Reach),
+                findall(W,
+                        (   member(W, Reach),
+                            memberchk(W-Back, Closure),
+                            memberchk(V, Back)
+                        ),
+                        Cycle0),
+                maplist(atom_string, Cycle0, Cycle)
+            ),
+            Cycles0),
+    sort(Cycles0, Cycles).
+
+%!  sweep_dependency_graph_dot(+Root, -Dot) is det.
+%
+%   Dot is a string with the dependency graph in Graphviz DOT format,
+%   restricted to files under Root as in sweep_dependency_cycles/2.
+%   Edges are labeled with the predicates that they resolve, and
+%   edges of unused dependencies are dashed.
+
+sweep_dependency_graph_dot(Root, Dot) :-
+    sweep_dependency_graph_refresh,
+    findall(edge(From, To, PIs),
+            sweep_dependency_graph_edge(Root, From, To, PIs),
+            Edges),
+    with_output_to(string(Dot),
+                   (   format("digraph dependencies {~n"),
+                       forall(member(Edge, Edges),
+                              sweep_dependency_graph_dot_edge(Edge)),
+                       format("}~n")
+                   )).
+
+sweep_dependency_graph_dot_edge(edge(From, To, PIs)) :-
+    sweep_dot_quote(From, F),
+    sweep_dot_quote(To, T),
+    (   PIs == []
+    ->  format("  ~w -> ~w [style=dashed];~n", [F, T])
+    ;   atomic_list_concat(PIs, ', ', Label0),
+        sweep_dot_quote(Label0, Label),
+        format("  ~w -> ~w [label=~w];~n", [F, T, Label])
+    ).
+
+sweep_dot_quote(Atom, Quoted) :-
+    atomic_list_concat(Parts0, '\\', Atom),
+    atomic_list_concat(Parts0, '\\\\', Atom1),
+    atomic_list_concat(Parts, '"', Atom1),
+    atomic_list_concat(Parts, '\\"', Escaped),
+    format(atom(Quoted), '"~w"', [Escaped]).
+
+sweep_dependency_graph_edge(Root, From, To, PIs) :-
+    sweep_dependency_edge(From, To, PIs),
+    (   Root == []
+    ->  true
+    ;   sub_atom(From, 0, _, _, Root),
+        sub_atom(To, 0, _, _, Root)
+    ).
+
+%   The dependency graph has an edge from each cross referenced source
+%   to each file that it loads or imports from, labeled with the
+%   predicates that the source calls and that the file defines.  We
+%   recompute the edges of a source from its cross reference data
+%   once per modification time of the source, and keep them when that
+%   data is evicted, so the graph spans all sources Sweep has seen.
+
+:- dynamic sweep_dependency_edge/3,
+           sweep_dependency_graph_time/2.
+
+sweep_dependency_graph_update(Source) :-
+    sweep_source_time(Source, Time),
+    (   sweep_dependency_graph_time(Source, Time)
+    ->  true
+    ;   sweep_xref(Source),
+        findall(To-PIs, sweep_dependency_edge_(Source, To, PIs), Edges),
+        retractall(sweep_dependency_edge(Source, _, _)),
+        forall(member(To-PIs, Edges),
+               assertz(sweep_dependency_edge(Source, To, PIs))),
+        retractall(sweep_dependency_graph_time(Source, _)),
+        assertz(sweep_dependency_graph_time(Source, Time))
+    ).
+
+sweep_dependency_edge_(Source, To, PIs) :-
+    setof(To0, sweep_dependency_target(Source, To0), Tos),
+    member(To, Tos),
+    findall(PI,
+            (   xref_defined(Source, Head, imported(To)),
+                xref_called(Source, Head, _),
+                pi_head(PI0, Head),
+                term_string(PI0, PI)
+            ),
+            PIs0),
+    sort(PIs0, PIs).
+
+sweep_dependency_target(Source, To) :-
+    xref_uses_file(Source, _, To),
+    atom(To),
+    exists_file(To).
+sweep_dependency_target(Source, To) :-
+    xref_defined(Source, _, imported(To)).
+
+%!  sweep_dependency_graph_refresh is det.
+%
+%   Bring the dependency graph up to date with all cross referenced
+%   sources, dropping the edges of sources that no longer exist.
+
+sweep_dependency_graph_refresh :-
+    findall(Source,
+            (   (   xref_current_source(Source)
+                ;   sweep_dependency_graph_time(Source, _)
+                ),
+                atom(Source)
+            ),
+            Sources0),
+    sort(Sources0, Sources),
+    forall(member(Source, Sources),
+           catch(sweep_dependency_graph_update(Source), _,
+                 (   retractall(sweep_dependency_edge(Source, _, _)),
+                     retractall(sweep_dependency_graph_time(Source, _))
+                 ))).
 
 sweep_cleanup_threads(_,_) :-
+    sweep_top_level_local_server_stop,
     sweep_cleanup_threads.
 
 sweep_cleanup_threads :-
@@ -2010,24 +3736,81 @@ sweep_thread_at_exit :-
     ;   true
     ).
 
+%   The supervisor keeps the threads that sweep_create_thread/3 starts
+%   in an assoc, along with the number of threads that exited and that
+%   leaked, i.e. that stopped running without reporting their exit.
+%   It joins exited threads to reclaim their stacks right away, taking
+%   all pending exit messages at once.
+
 sweep_supervisor_start(Caller) :-
     thread_send_message(Caller, sweep_supervisor_started),
-    sweep_supervisor_loop([]).
+    empty_assoc(Threads),
+    sweep_supervisor_loop(supervisor(Threads, 0, 0)).
 
-sweep_supervisor_loop(Threads) :-
+sweep_supervisor_loop(State) :-
     thread_get_message(Message),
-    sweep_supervisor_loop_(Message, Threads).
-
-sweep_supervisor_loop_(cleanup, Ts) =>
-    maplist(cleanup_thread, Ts).
-sweep_supervisor_loop_(new(T), Ts) =>
-    sweep_supervisor_loop([T|Ts]).
-sweep_supervisor_loop_(exit(T), Ts0) =>
-    cleanup_thread(T),
-    select(T, Ts0, Ts),
-    sweep_supervisor_loop(Ts).
-sweep_supervisor_loop_(_, Ts) =>
-    sweep_supervisor_loop(Ts).
+    sweep_supervisor_loop_(Message, State).
+
+sweep_supervisor_loop_(cleanup, supervisor(Ts, _, _)) =>
+    assoc_to_keys(Ts, Threads),
+    maplist(cleanup_thread, Threads).
+sweep_supervisor_loop_(new(T), supervisor(Ts0, Exited, Leaked)) =>
+    put_assoc(T, Ts0, true, Ts),
+    sweep_supervisor_loop(supervisor(Ts, Exited, Leaked)).
+sweep_supervisor_loop_(exit(T), supervisor(Ts0, Exited0, Leaked)) =>
+    thread_self(Self),
+    sweep_supervisor_pending_exits(Self, Ts1),
+    foldl(sweep_supervisor_reap, [T|Ts1], Ts0-Exited0, Ts-Exited),
+    sweep_supervisor_loop(supervisor(Ts, Exited, Leaked)).
+sweep_supervisor_loop_(stats(Caller), supervisor(Ts0, Exited, Leaked0)) =>
+    assoc_to_keys(Ts0, Threads),
+    include(sweep_supervisor_leaked, Threads, Leaks),
+    foldl(sweep_supervisor_reap, Leaks, Ts0-0, Ts-New),
+    Leaked is Leaked0 + New,
+    assoc_to_keys(Ts, Live),
+    length(Live, Count),
+    thread_send_message(Caller, sweep_supervisor_stats(Count, Exited, Leaked)),
+    sweep_supervisor_loop(supervisor(Ts, Exited, Leaked)).
+sweep_supervisor_loop_(_, State) =>
+    sweep_supervisor_loop(State).
+
+sweep_supervisor_pending_exits(Self, Ts) :-
+    (   thread_get_message(Self, exit(T), [timeout(0)])
+    ->  Ts = [T|Ts1],
+        sweep_supervisor_pending_exits(Self, Ts1)
+    ;   Ts = []
+    ).
+
+%   Threads that we no longer track were already reaped, for instance
+%   as leaked before their exit message arrived, so we neither join
+%   nor count them again.
+
+sweep_supervisor_reap(T, Ts0-N0, Ts-N) :-
+    (   del_assoc(T, Ts0, _, Ts)
+    ->  catch(thread_join(T, _), _, cleanup_thread(T)),
+        N is N0 + 1
+    ;   Ts = Ts0,
+        N = N0
+    ).
+
+sweep_supervisor_leaked(T) :-
+    \+ catch(thread_property(T, status(running)), _, fail).
+
+%!  sweep_thread_statistics(+_, -Counts) is det.
+%
+%   Counts is a list [Live, Exited, Leaked] with the number of threads
+%   that the supervisor tracks, that exited, and that stopped without
+%   reporting their exit.  Leaked threads are joined as a side effect.
+
+sweep_thread_statistics(_, [Live, Exited, Leaked]) :-
+    thread_self(Self),
+    (   is_thread(sweep_supervisor),
+        thread_send_message(sweep_supervisor, stats(Self)),
+        thread_get_message(Self, sweep_supervisor_stats(Live, Exited, Leaked),
+                           [timeout(5)])
+    ->  true
+    ;   Live = 0, Exited = 0, Leaked = 0
+    ).
 
 sweep_kill_thread(T, _) :-
     cleanup_thread(T).
@@ -2049,26 +3832,286 @@ cleanup_thread_(T) :-
 cleanup_thread_(T) :-
     thread_signal(T, thread_exit(0)).
 
-sweep_async_goal([GoalString|FD], TId) :-
+%!  sweep_async_goal(+Spec, -Id) is det.
+%
+%   Spec is a list [GoalString|FD].  Queue a job Id that runs the goal
+%   in GoalString with its output directed to file descriptor FD.
+%   Jobs run on a pool of reusable worker threads, see
+%   sweep_set_async_pool/2.  If all workers are busy, an extra worker
+%   takes the job and exits when no such jobs are left, so long
+%   running goals do not hold up others.
+
+sweep_async_goal([GoalString|FD], Id) :-
+    sweep_async_submit(GoalString, 0, FD, extra, Id).
+
+%!  sweep_async_schedule(+Spec, -Id) is det.
+%
+%   Spec is a list [GoalString, Priority|FD].  Like sweep_async_goal/2,
+%   but the job waits for a worker of the pool, so no more scheduled
+%   jobs run at once than there are workers.  Waiting jobs start in
+%   order of decreasing Priority, and in order of submission among
+%   jobs with the same priority.  Jobs from sweep_async_goal/2 start
+%   before any scheduled job.
+
+sweep_async_schedule([GoalString, Priority|FD], Id) :-
+    sweep_async_submit(GoalString, Priority, FD, pool, Id).
+
+sweep_async_submit(GoalString, Priority, FD, Kind, Id) :-
     term_string(Goal, GoalString),
-    random_between(1, 1024, Cookie),
-    thread_self(Self),
-    sweep_create_thread(sweep_start_async_goal(Self, Cookie, Goal, FD), T),
-    thread_get_message(sweep_async_goal_started(Cookie)),
-    thread_property(T, id(TId)).
+    flag(sweep_async_job, Id, Id + 1),
+    get_time(Now),
+    (   Kind == extra
+    ->  Key = 0-0
+    ;   Key = 1-Order,
+        Order is -Priority
+    ),
+    with_mutex(sweep_async_jobs,
+               (   sweep_async_pool_ensure(Kind),
+                   assertz(sweep_async_job_queued(Key, Id, Goal, FD)),
+                   assertz(sweep_async_job(Id, GoalString, Priority, Now, queued)),
+                   sweep_async_jobs_prune
+               )),
+    thread_send_message(sweep_async_jobs, wake).
+
+sweep_async_pool_ensure(Kind) :-
+    (   message_queue_property(_, alias(sweep_async_jobs))
+    ->  true
+    ;   message_queue_create(_, [alias(sweep_async_jobs)])
+    ),
+    forall(( sweep_async_worker(T, _),
+             \+ catch(thread_property(T, status(running)), _, fail)
+           ),
+           retractall(sweep_async_worker(T, _))),
+    sweep_async_pool_config(Size, Options),
+    aggregate_all(count, sweep_async_worker(_, pool), Workers),
+    aggregate_all(count, sweep_async_job(_, _, _, _, running(_, _, _)), Running),
+    (   Workers < Size
+    ->  Missing is Size - Workers,
+        forall(between(1, Missing, _), sweep_async_worker_create(pool, Options))
+    ;   Kind == extra,
+        Running >= Workers
+    ->  sweep_async_worker_create(extra, Options)
+    ;   true
+    ).
+
+sweep_async_pool_config(Size, Options) :-
+    (   sweep_async_pool(Size0, StackLimit)
+    ->  true
+    ;   Size0 = 2, StackLimit = []
+    ),
+    Size is max(1, Size0),
+    (   integer(StackLimit)
+    ->  Options = [stack_limit(StackLimit)]
+    ;   Options = []
+    ).
 
-sweep_start_async_goal(Caller, Cookie, Goal, FD) :-
-    thread_send_message(Caller, sweep_async_goal_started(Cookie)),
+sweep_async_worker_create(Kind, Options) :-
+    sweep_create_thread(sweep_async_worker(Kind), T, Options),
+    assertz(sweep_async_worker(T, Kind)).
+
+%   Keep the records of the last 256 finished jobs.
+
+sweep_async_jobs_prune :-
+    aggregate_all(count, sweep_async_job(_, _, _, _, done(_, _, _, _)), Done),
+    (   Done > 256
+    ->  once(retract(sweep_async_job(_, _, _, _, done(_, _, _, _))))
+    ;   true
+    ).
+
+%!  sweep_set_async_pool(+Spec, -_) is det.
+%
+%   Spec is a list [Size|StackLimit] that configures the number of
+%   worker threads for async goals and their stack limit in bytes, or
+%   [] for the default stack limit.  Current workers exit once they
+%   are idle, and new workers start with the new configuration, right
+%   away if jobs are waiting.
+
+sweep_set_async_pool([Size|StackLimit], _) :-
+    with_mutex(sweep_async_jobs,
+               (   retractall(sweep_async_pool(_, _)),
+                   assertz(sweep_async_pool(Size, StackLimit)),
+                   forall(retract(sweep_async_worker(_, _)),
+                          sweep_async_worker_stop)
+               )),
+    (   sweep_async_job_queued(_, _, _, _)
+    ->  with_mutex(sweep_async_jobs, sweep_async_pool_ensure(pool)),
+        thread_send_message(sweep_async_jobs, wake)
+    ;   true
+    ).
+
+sweep_async_worker_stop :-
+    (   message_queue_property(_, alias(sweep_async_jobs))
+    ->  thread_send_message(sweep_async_jobs, stop)
+    ;   true
+    ).
+
+%   Workers exit when they are no longer registered in
+%   sweep_async_worker/2, which happens when the pool is reconfigured
+%   or, for extra workers, when no jobs of sweep_async_goal/2 wait.
+%   Messages in the sweep_async_jobs queue only wake up idle workers,
+%   which then take the first waiting job they may run.
+
+sweep_async_worker(Kind) :-
+    repeat,
+    catch(sweep_async_worker_step(Kind, Done),
+          sweep_async_interrupted(_),
+          Done = false),
+    Done == true,
+    !.
+
+sweep_async_worker_step(Kind, Done) :-
+    (   with_mutex(sweep_async_jobs, sweep_async_job_take(Kind, Job))
+    ->  sweep_async_worker_run(Job),
+        sweep_async_worker_retired(Done)
+    ;   Kind == pool
+    ->  thread_get_message(sweep_async_jobs, _),
+        sweep_async_worker_retired(Done)
+    ;   thread_self(T),
+        with_mutex(sweep_async_jobs, retractall(sweep_async_worker(T, _))),
+        Done = true
+    ).
+
+sweep_async_job_take(Kind, job(Id, Goal, FD)) :-
+    (   Kind == pool
+    ->  true
+    ;   Pattern = 0-_
+    ),
+    findall(K-I,
+            (   sweep_async_job_queued(K, I, _, _),
+                K = Pattern
+            ),
+            Queued),
+    min_member(Key-Id, Queued),
+    retract(sweep_async_job_queued(Key, Id, Goal, FD)),
+    retract(sweep_async_job(Id, GoalString, Priority, Submitted, queued)),
+    thread_self(T),
+    get_time(Start),
+    statistics(cputime, CPU0),
+    assertz(sweep_async_job(Id, GoalString, Priority, Submitted,
+                            running(T, Start, CPU0))).
+
+sweep_async_worker_retired(Done) :-
+    thread_self(T),
+    (   with_mutex(sweep_async_jobs, sweep_async_worker(T, _))
+    ->  Done = false
+    ;   Done = true
+    ).
+
+sweep_async_worker_run(job(Id, Goal, FD)) :-
+    setup_call_cleanup(nb_setval(sweep_async_current_job, Id),
+                       catch(sweep_start_async_goal(Id, Goal, FD),
+                             sweep_async_interrupted(Id),
+                             sweep_async_job_finish(Id, interrupted)),
+                       nb_setval(sweep_async_current_job, [])).
+
+%   thread_signal/2 is asynchronous, so by the time a worker handles
+%   an interrupt for job Id it may have moved on to another job.  We
+%   only interrupt the worker if it still runs job Id.
+
+sweep_async_interrupt(Id) :-
+    (   nb_current(sweep_async_current_job, Id)
+    ->  throw(sweep_async_interrupted(Id))
+    ;   true
+    ).
+
+sweep_async_job_finish(Id, Result) :-
+    (   var(Result)
+    ->  Result = interrupted
+    ;   true
+    ),
+    get_time(End),
+    statistics(cputime, CPU1),
+    statistics(stack, Stack),
+    with_mutex(sweep_async_jobs,
+               (   retract(sweep_async_job(Id, GoalString, Priority, Submitted,
+                                           running(_, Start, CPU0)))
+               ->  Wall is End - Start,
+                   CPU is CPU1 - CPU0,
+                   assertz(sweep_async_job(Id, GoalString, Priority, Submitted,
+                                           done(Result, Wall, CPU, Stack)))
+               ;   true
+               )).
+
+%   Record the result of job Id before closing its output, so that
+%   Emacs sees the final status of the job once the output ends.
+%
+%   We rebind user_output and user_error of the worker to the job's
+%   output stream rather than using set_prolog_IO/3, which creates a
+%   fresh user_error stream when output and error are the same, and
+%   would thus leak one stream per job in a reused worker.
+
+sweep_start_async_goal(Id, Goal, FD) :-
+    stream_property(Out0, alias(user_output)),
+    stream_property(Err0, alias(user_error)),
+    current_output(Cur0),
     setup_call_cleanup((   sweep_fd_open(FD, Out),
-                           set_prolog_IO(current_input, Out, Out)
+                           set_stream(Out, alias(user_output)),
+                           set_stream(Out, alias(user_error)),
+                           set_output(Out)
                        ),
-                       once(Goal),
-                       (   format("~nSweep async goal finished~n"),
+                       catch((   once(Goal)
+                             ->  Result = succeeded
+                             ;   Result = failed
+                             ),
+                             Error,
+                             (   Error = sweep_async_interrupted(_)
+                             ->  throw(Error)
+                             ;   print_message(error, Error),
+                                 Result = error
+                             )),
+                       (   sweep_async_job_finish(Id, Result),
+                           format("~nSweep async goal finished~n"),
+                           set_stream(Out0, alias(user_output)),
+                           set_stream(Err0, alias(user_error)),
+                           set_output(Cur0),
                            close(Out)
                        )).
 
-sweep_interrupt_async_goal(TId, TId) :-
-    thread_signal(TId, throw(interrupted)).
+sweep_interrupt_async_goal(Id, Id) :-
+    with_mutex(sweep_async_jobs,
+               (   sweep_async_job(Id, _, _, _, running(T, _, _))
+               ->  thread_signal(T, sweep_async_interrupt(Id))
+               ;   retract(sweep_async_job_queued(_, Id, _, FD))
+               ->  retract(sweep_async_job(Id, GoalString, Priority, Submitted, queued)),
+                   assertz(sweep_async_job(Id, GoalString, Priority, Submitted,
+                                           done(cancelled, 0, 0, 0)))
+               ;   true
+               )),
+    (   nonvar(FD)
+    ->  sweep_fd_open(FD, Out),
+        format(Out, "~nSweep async goal finished~n", []),
+        close(Out)
+    ;   true
+    ).
+
+%!  sweep_async_jobs(+_, -Rows) is det.
+%
+%   Rows lists the known async jobs as [Id, Goal, Priority, Status,
+%   Wall, CPU, Stack], where Wall and CPU are the wall clock and CPU
+%   seconds that a job has taken so far and Stack is the stack usage
+%   of its thread in bytes.  These are [] for waiting jobs.
+
+sweep_async_jobs(_, Rows) :-
+    get_time(Now),
+    findall([Id, GoalString, Priority, Status, Wall, CPU, Stack],
+            (   sweep_async_job(Id, GoalString, Priority, _, State),
+                sweep_async_job_row(State, Now, Status, Wall, CPU, Stack)
+            ),
+            Rows).
+
+sweep_async_job_row(queued, _, "queued", [], [], []).
+sweep_async_job_row(running(T, Start, CPU0), Now, "running", Wall, CPU, Stack) :-
+    Wall is Now - Start,
+    (   sweep_thread_usage(T, Stack, CPU1)
+    ->  CPU is CPU1 - CPU0
+    ;   CPU = [], Stack = []
+    ).
+sweep_async_job_row(done(Result, Wall, CPU, Stack), _, Status, Wall, CPU, Stack) :-
+    atom_string(Result, Status).
+
+sweep_async_jobs_clear(_, _) :-
+    with_mutex(sweep_async_jobs,
+               retractall(sweep_async_job(_, _, _, _, done(_, _, _, _)))).
 
 sweep_set_breakpoint([File0,Line,Char], Id) :-
     atom_string(File, File0),
@@ -2090,10 +4133,27 @@ format_breakpoint(Id-Clause, [["id"|Id],["predicate"|Pred],["clause"|ClauseNum]|
     clause_property(Clause, predicate(Pred0)),
     term_string(Pred0, Pred),
     pi_head(Pred0, Head),
-    nth_clause(Head, ClauseNum, Clause),
+    sweep_breakpoint_clause_number(Id, Head, Clause, ClauseNum),
     findall(Prop, breakpoint_property(Id, Prop), Props),
     convlist(format_breakpoint_property, Props, BP).
 
+%   Finding the number of a clause takes a scan of the clauses of its
+%   predicate, so we remember it for each breakpoint.  Clauses of
+%   static predicates keep their position until they are reloaded,
+%   which gives them new clause references, while dynamic predicates
+%   can gain clauses in front of the breakpoint at any time.
+
+:- dynamic sweep_breakpoint_clause/3.
+
+sweep_breakpoint_clause_number(Id, Head, Clause, ClauseNum) :-
+    (   sweep_breakpoint_clause(Id, Clause, ClauseNum0),
+        \+ predicate_property(Head, dynamic)
+    ->  ClauseNum = ClauseNum0
+    ;   nth_clause(Head, ClauseNum, Clause),
+        retractall(sweep_breakpoint_clause(Id, _, _)),
+        assertz(sweep_breakpoint_clause(Id, Clause, ClauseNum))
+    ).
+
 format_breakpoint_property(file(File0), ["file"|File]) :-
     atom_string(File0, File).
 format_breakpoint_property(line_count(Line), ["line"|Line]).
@@ -2103,16 +4163,91 @@ format_breakpoint_property(condition(Cond), ["condition"|Cond]).
 
 sweep_current_breakpoints_in_region([Path0, Beg, End], BPs) :-
     atom_string(Path, Path0),
+    sweep_breakpoint_index_ensure,
+    sweep_breakpoint_bucket_size(Size),
+    Bucket0 is Beg // Size,
+    Bucket1 is End // Size,
     findall([BPBeg|BPEnd],
-            (   breakpoint_property(BPId, file(Path)),
-                breakpoint_property(BPId, character_range(BPBeg0, Len)),
-                BPBeg is BPBeg0 + 1,
+            (   between(Bucket0, Bucket1, Bucket),
+                sweep_breakpoint_bucket(Path, Bucket, BPBeg, BPEnd, _),
                 Beg =< BPBeg,
-                BPBeg =< End,
-                BPEnd is BPBeg + Len
+                BPBeg =< End
             ),
             BPs).
 
+%!  sweep_breakpoints_at_point(+Spec, -BPs) is det.
+%
+%   BPs is the list of breakpoints whose character range in Path
+%   includes Point, formatted as in sweep_current_breakpoints/2.
+%   Spec is a list [Path, Point].  Breakpoints that include Point
+%   start in Point's bucket or in an earlier one.
+
+sweep_breakpoints_at_point([Path0, Point], BPs) :-
+    atom_string(Path, Path0),
+    sweep_breakpoint_index_ensure,
+    sweep_breakpoint_bucket_size(Size),
+    Bucket1 is Point // Size,
+    findall(Id-Clause,
+            (   between(0, Bucket1, Bucket),
+                sweep_breakpoint_bucket(Path, Bucket, BPBeg, BPEnd, Id),
+                BPBeg =< Point,
+                Point =< BPEnd,
+                breakpoint_property(Id, clause(Clause))
+            ),
+            BPs0),
+    maplist(format_breakpoint, BPs0, BPs).
+
+%   The breakpoint index maps each file and bucket of character
+%   offsets to the breakpoints that start in that bucket, so region
+%   queries only look at the buckets that the region overlaps.  We
+%   build the index on first use and keep it up to date by observing
+%   the messages that library(prolog_breakpoints) prints when it sets
+%   and deletes breakpoints, see sweep_message_observe/1.
+
+:- dynamic sweep_breakpoint_bucket/5,
+           sweep_breakpoint_index_ready/0.
+
+sweep_breakpoint_bucket_size(4096).
+
+sweep_breakpoint_index_ensure :-
+    sweep_breakpoint_index_ready,
+    !.
+sweep_breakpoint_index_ensure :-
+    with_mutex(sweep_breakpoint_index,
+               (   sweep_breakpoint_index_ready
+               ->  true
+               ;   retractall(sweep_breakpoint_bucket(_, _, _, _, _)),
+                   forall(breakpoint_property(Id, file(_)),
+                          sweep_breakpoint_index_add(Id)),
+                   assertz(sweep_breakpoint_index_ready)
+               )).
+
+sweep_breakpoint_index_add(Id) :-
+    (   breakpoint_property(Id, file(Path)),
+        breakpoint_property(Id, character_range(Beg0, Len))
+    ->  Beg is Beg0 + 1,
+        End is Beg + Len,
+        sweep_breakpoint_bucket_size(Size),
+        Bucket is Beg // Size,
+        assertz(sweep_breakpoint_bucket(Path, Bucket, Beg, End, Id))
+    ;   true
+    ).
+
+sweep_breakpoint_event(Action, Id) :-
+    sweep_breakpoint_index_ready,
+    with_mutex(sweep_breakpoint_index,
+               sweep_breakpoint_event_(Action, Id)).
+
+sweep_breakpoint_event_(set, Id) :-
+    !,
+    retractall(sweep_breakpoint_bucket(_, _, _, _, Id)),
+    sweep_breakpoint_index_add(Id).
+sweep_breakpoint_event_(delete, Id) :-
+    !,
+    retractall(sweep_breakpoint_bucket(_, _, _, _, Id)),
+    retractall(sweep_breakpoint_clause(Id, _, _)).
+sweep_breakpoint_event_(_, _).
+
 sweep_breakpoint_range(Id, [Beg|End]) :-
     breakpoint_property(Id, character_range(Beg0, Len)),
     Beg is Beg0 + 1,
@@ -2179,11 +4314,9 @@ sweep_extract_goal([ClauseString,GoalBeg,GoalEnd,Functor0,FileName0],
     atom_string(Functor1, Functor0),
     term_string(Functor1, Functor),
     atom_string(FileName, FileName0),
-    xref_source(FileName),
+    sweep_xref(FileName),
     sweep_module_path_(Mod, FileName),
-    term_string(Clause, ClauseString, [subterm_positions(Pos0),
-                                       variable_names(ClauseVarNames),
-                                       module(Mod)]),
+    sweep_parse_term(FileName, ClauseString, Clause, Pos0, ClauseVarNames),
     clause_body_pos_neck(Clause, Pos0, Body0, Pos, Meta, Pri),
     pos_bounds(Pos, PosBeg, PosEnd),
     (   GoalBeg =< PosBeg, PosEnd =< GoalEnd
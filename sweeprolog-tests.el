@@ -1546,13 +1546,15 @@ foo :-
       baz")))
 
 (defun sweeprolog-test-indentation (given expected)
-  (with-temp-buffer
-    (sweeprolog-mode)
-    (insert given)
-    (let ((inhibit-message t))
-      (indent-region-line-by-line (point-min) (point-max)))
-    (should (string= (buffer-substring-no-properties (point-min) (point-max))
-                     expected))))
+  (dolist (fun (list #'indent-region-line-by-line
+                     #'sweeprolog-indent-region))
+    (with-temp-buffer
+      (sweeprolog-mode)
+      (insert given)
+      (let ((inhibit-message t))
+        (funcall fun (point-min) (point-max)))
+      (should (string= (buffer-substring-no-properties (point-min) (point-max))
+                       expected)))))
 
 (defun sweeprolog-test-context-callable-p (given expected)
   (with-temp-buffer
@@ -2478,5 +2480,597 @@ foo(_) --> [].
                    (4 . 15)))))
 
 
+(ert-deftest profile-data ()
+  "Test collecting Prolog query statistics."
+  (sweeprolog-profile-mode 1)
+  (unwind-protect
+      (progn
+        (sweeprolog-profile-data t)
+        (sweeprolog--query-once "user" "sweep_funcall"
+                                "sweeprolog-tests-greet-1")
+        (sweeprolog--query-once "user" "sweep_funcall"
+                                "sweeprolog-tests-greet-1")
+        (let ((entry (assoc "user:sweep_funcall" (sweeprolog-profile-data))))
+          (should entry)
+          (should (= (nth 1 entry) 2))
+          (should (<= (nth 3 entry) (nth 2 entry)))
+          (should (= (nth 5 entry) (* 2 (length sweeprolog-tests-greeting))))
+          (should (= (nth 6 entry) 2))))
+    (sweeprolog-profile-mode -1)))
+
+(ert-deftest callback-trace-data ()
+  "Test tracing calls from Prolog to Elisp."
+  (sweeprolog-callback-trace-mode 1)
+  (unwind-protect
+      (progn
+        (sweeprolog-callback-trace-data t)
+        (sweeprolog--query-once "user" "sweep_funcall"
+                                "sweeprolog-tests-greet-1")
+        (let ((entry (assoc "sweeprolog-tests-greet-1"
+                            (sweeprolog-callback-trace-data)))
+              (events (sweeprolog-callback-trace-events)))
+          (should entry)
+          (should (= (nth 1 entry) 1))
+          (should (= (nth 4 entry) (length sweeprolog-tests-greeting)))
+          (should (= (apply #'+ (nth 5 entry)) 1))
+          (should (= (length events) 1))
+          (should (equal (car (car events)) "sweeprolog-tests-greet-1"))))
+    (sweeprolog-callback-trace-mode -1)))
+
+(sweeprolog-deftest memory-report ()
+  "Test reporting and purging cross reference data."
+  "foo(X) :- bar(X).
+bar(1).
+"
+  (sweeprolog-xref-buffer)
+  (let ((name (buffer-file-name)))
+    (should (member (list "Xref" name 3 nil)
+                    (sweeprolog--query-once "sweep" "sweep_memory_report" nil)))
+    (sweeprolog--query-once "sweep" "sweep_xref_purge" (list name))
+    (should (equal (seq-filter (lambda (row) (equal (car row) "Xref"))
+                               (sweeprolog--query-once "sweep" "sweep_memory_report" nil))
+                   (list (list "Xref" name 3 nil))))
+    (should (= (sweeprolog--query-once "sweep" "sweep_xref_purge" nil) 1))
+    (should-not (seq-find (lambda (row)
+                            (and (equal (car row) "Xref")
+                                 (equal (cadr row) name)))
+                          (sweeprolog--query-once "sweep" "sweep_memory_report" nil)))))
+
+(ert-deftest xref-cache-limit ()
+  "Test evicting least recently used cross reference data."
+  (let ((foo (make-temp-file "sweeprolog-test" nil ".pl" "foo.\n"))
+        (bar (make-temp-file "sweeprolog-test" nil ".pl" "bar.\n")))
+    (unwind-protect
+        (progn
+          (sweeprolog--query-once "sweep" "sweep_set_xref_cache_limit" 1)
+          (sweeprolog--query-once "sweep" "sweep_xref_source" foo)
+          (sweeprolog--query-once "sweep" "sweep_xref_source" bar)
+          (let ((sources (mapcar #'cadr
+                                 (seq-filter (lambda (row) (equal (car row) "Xref"))
+                                             (sweeprolog--query-once
+                                              "sweep" "sweep_memory_report" nil)))))
+            (should-not (member foo sources))
+            (should (equal sources (list bar)))))
+      (sweeprolog--query-once "sweep" "sweep_set_xref_cache_limit"
+                              sweeprolog-xref-cache-max-sources)
+      (delete-file foo)
+      (delete-file bar))))
+
+(sweeprolog-deftest forward-predicate-after-change ()
+  "Test moving to the next predicate after editing the buffer."
+  "foo :- true.
+bar :- foo.
+"
+  (sweeprolog-forward-predicate)
+  (should (= (line-number-at-pos) 2))
+  (goto-char (point-min))
+  (insert "baz.\n\n")
+  (goto-char (point-min))
+  (sweeprolog-forward-predicate)
+  (should (= (line-number-at-pos) 3))
+  (sweeprolog-forward-predicate)
+  (should (= (line-number-at-pos) 4)))
+
+(sweeprolog-deftest op-table ()
+  "Test updating the operator table after defining an operator."
+  ":- module(op_table, []).
+"
+  (should (= (sweeprolog-op-infix-precedence ":-") 1200))
+  (should-not (sweeprolog-op-infix-precedence "===>"))
+  (goto-char (point-max))
+  (insert ":- op(700, xfx, ===>).\n")
+  (sweeprolog-analyze-buffer t)
+  (should (= (sweeprolog-op-infix-precedence "===>") 700))
+  (should-not (sweeprolog-op-prefix-precedence "===>")))
+
+(sweeprolog-deftest term-tokens ()
+  "Test indexing the tokens of a term."
+  "foo(Bar, \"baz\") :- X is [1|Y], {a}.
+"
+  (sweeprolog--token-index-ensure)
+  (should (equal (nth 3 sweeprolog--token-index)
+                 [(functor 1 5) (symbol 5 8) (operator 8 9) (string 10 15)
+                  (close 15 16) (operator 17 19) (symbol 20 21)
+                  (symbol 22 24) (open 25 26) (symbol 26 27)
+                  (operator 27 28) (symbol 28 29) (close 29 30)
+                  (operator 30 31) (open 32 33) (symbol 33 34)
+                  (close 34 35) (operator 35 36)]))
+  (should (equal (sweeprolog-last-token-boundaries 25) '(symbol 22 24)))
+  (should (equal (sweeprolog-next-token-boundaries 24) '(open 25 26)))
+  (goto-char 20)
+  (forward-sexp)
+  (should (= (point) 21))
+  (forward-sexp)
+  (should (= (point) 30)))
+
+(sweeprolog-deftest terms-at-point-after-change ()
+  "Test that `sweeprolog-terms-at-point' reflects buffer changes."
+  "
+foo(X) :- bar(X, baz).
+"
+  (should (equal (sweeprolog-terms-at-point 20)
+                 (sweeprolog-terms-at-point 20)))
+  (should (member "bar(X, baz)" (sweeprolog-terms-at-point 20)))
+  (goto-char 19)
+  (delete-char 3)
+  (insert "qux")
+  (should (member "bar(X, qux)" (sweeprolog-terms-at-point 20))))
+
+(sweeprolog-deftest term-replace-edits-prefilter ()
+  "Test `sweeprolog-term-replace-edits' with clauses that cannot match."
+  "
+foo(X) :- bar(X), baz(X).
+qux :- bar(1).
+quux(Y) :- baz(Y).
+"
+  (should (equal (sweeprolog-term-replace-edits (buffer-file-name)
+                                                "bar(A)" "spam(A)"
+                                                "true" '(_))
+                 '((12 18 "spam(X)")
+                   (35 41 "spam(1)")))))
+
+(ert-deftest functor-occurrences ()
+  "Test finding terms by functor with the functor occurrence index."
+  (let ((file (make-temp-file "sweeprolog-test" nil ".pl"
+                              "foo(point(1, 2)).\nbar(X) :- X = point(3, 4), baz(X).\n")))
+    (unwind-protect
+        (progn
+          (should (equal (sweeprolog--query-once "sweep" "sweep_functor_occurrences"
+                                                 (list "point" 2 (list file)))
+                         (list (list file 1 4 "foo(point(1, 2)).")
+                               (list file 2 14
+                                     "bar(X) :- X = point(3, 4), baz(X)."))))
+          (should-not (sweeprolog--query-once "sweep" "sweep_functor_occurrences"
+                                              (list "point" 3 (list file)))))
+      (delete-file file))))
+
+(ert-deftest async-goal-pool ()
+  "Test running several async goals on the worker pool."
+  (skip-unless (fboundp 'sweeprolog-open-channel))
+  (let ((buffers nil))
+    (unwind-protect
+        (progn
+          (dotimes (i 4)
+            (let ((buffer (generate-new-buffer " *sweeprolog-async-test*")))
+              (push buffer buffers)
+              (sweeprolog-async-goal-start (format "format(\"job ~w~n\", [%d])" i)
+                                           buffer)))
+          (dolist (buffer buffers)
+            (with-timeout (10 (ert-fail "Timed out waiting for async goal"))
+              (while (get-buffer-process buffer)
+                (accept-process-output nil 0.1))))
+          (let ((i 4))
+            (dolist (buffer buffers)
+              (setq i (1- i))
+              (with-current-buffer buffer
+                (should (string-match-p (format "job %d" i)
+                                        (buffer-string)))))))
+      (mapc #'kill-buffer buffers))))
+
+(ert-deftest async-schedule ()
+  "Test scheduling async goals and listing their status."
+  (skip-unless (fboundp 'sweeprolog-open-channel))
+  (let* ((jobs (list (sweeprolog-schedule-async-goal "true" 1)
+                     (sweeprolog-schedule-async-goal "fail" 2)))
+         (buffers (mapcar #'sweeprolog-async-jobs--buffer jobs)))
+    (unwind-protect
+        (progn
+          (dolist (buffer buffers)
+            (with-timeout (10 (ert-fail "Timed out waiting for async goal"))
+              (while (get-buffer-process buffer)
+                (accept-process-output nil 0.1))))
+          (let ((rows (sweeprolog--query-once "sweep" "sweep_async_jobs" nil)))
+            (should (equal (nth 3 (assoc (car jobs) rows)) "succeeded"))
+            (should (equal (nth 3 (assoc (cadr jobs) rows)) "failed"))))
+      (mapc #'kill-buffer buffers))))
+
+(ert-deftest thread-statistics ()
+  "Test counting supervised Prolog threads."
+  (skip-unless (fboundp 'sweeprolog-open-channel))
+  (let ((buffer (generate-new-buffer " *sweeprolog-async-test*"))
+        (gone (lambda (stats) (+ (nth 1 stats) (nth 2 stats))))
+        (before nil)
+        (after nil))
+    (unwind-protect
+        (progn
+          ;; Start three pool workers, and let them finish a job.
+          (sweeprolog--query-once "sweep" "sweep_set_async_pool" (cons 3 nil))
+          (sweeprolog-async-goal-start "true" buffer 1)
+          (with-timeout (10 (ert-fail "Timed out waiting for async goal"))
+            (while (get-buffer-process buffer)
+              (accept-process-output nil 0.1)))
+          ;; Wait for workers of previous pools to finish exiting.
+          (setq after (sweeprolog-thread-statistics))
+          (with-timeout (10 (ert-fail "Timed out waiting for threads to settle"))
+            (while (not (equal before after))
+              (setq before after)
+              (sleep-for 0.2)
+              (setq after (sweeprolog-thread-statistics))))
+          ;; Reconfiguring the pool stops its three idle workers.
+          (sweeprolog--query-once "sweep" "sweep_set_async_pool" (cons 1 nil))
+          (with-timeout (10 (ert-fail "Timed out waiting for workers to exit"))
+            (while (< (funcall gone after) (+ 3 (funcall gone before)))
+              (sleep-for 0.1)
+              (setq after (sweeprolog-thread-statistics))))
+          (sleep-for 0.2)
+          (setq after (sweeprolog-thread-statistics))
+          ;; Threads that exit between two queries may be reaped as
+          ;; leaked before their exit message arrives.
+          (should (= (funcall gone after) (+ 3 (funcall gone before))))
+          (should (= (car after) (- (car before) 3))))
+      (kill-buffer buffer)
+      (sweeprolog--set-async-pool))))
+
+(ert-deftest top-level-local-transport ()
+  "Test running a top-level over a Unix-domain socket."
+  (skip-unless (featurep 'make-network-process '(:family local)))
+  (let ((sweeprolog-top-level-transport 'local)
+        (buf-name (generate-new-buffer-name "*test top-level*")))
+    (sweeprolog-top-level buf-name)
+    (with-current-buffer buf-name
+      (should sweeprolog-top-level-thread-id)
+      (should (eq (process-type (get-buffer-process buf-name)) 'network))
+      (should (< 0 (sweeprolog-top-level-benchmark--send
+                    (get-buffer-process buf-name)
+                    "X = foo.\n")))
+      (should (string-match-p "X = foo" (buffer-string)))
+      (sweeprolog-top-level-delete-process buf-name))))
+
+(sweeprolog-deftest eldoc-cached-signature ()
+  "Test ElDoc argument spans with cached top terms and signatures."
+  "
+:- module(eldoccached, []).
+
+:- use_module(library(lists)).
+
+foo(X, Y) :- member(X, Y).
+"
+  (goto-char (point-max))
+  (search-backward "X, Y)." nil t)
+  (let ((top-term (sweeprolog--eldoc-top-term)))
+    (save-excursion
+      (forward-char 3)
+      (should (eq (nth 2 (sweeprolog--eldoc-top-term)) (nth 2 top-term))))
+    (dolist (case '((0 . (7 . 12)) (3 . (13 . 18))))
+      (save-excursion
+        (forward-char (car case))
+        (let ((doc nil))
+          (sweeprolog-predicate-modes-doc (lambda (d &rest _) (setq doc d)))
+          (should (equal (substring-no-properties doc 0 25)
+                         "member(?Elem,?List) is un"))
+          (should (equal (next-single-property-change
+                          0 'face doc)
+                         (cadr case))))))
+    (insert " ")
+    (should-not (eq (nth 2 (sweeprolog--eldoc-top-term)) (nth 2 top-term)))))
+
+(sweeprolog-deftest comment-modes-cache ()
+  "Test the bounded cache of modes declared in PlDoc comments."
+  "
+:- module(commentmodescache, []).
+
+%!  foo(+Bar) is det.
+
+foo(_).
+
+%!  baz(-Qux) is semidet.
+
+baz(_).
+"
+  (sweeprolog-xref-buffer)
+  (let ((stat (lambda (name)
+                (nth 2 (seq-find (lambda (row)
+                                   (equal (seq-take row 2)
+                                          (list "Comment modes" name)))
+                                 (sweeprolog--query-once
+                                  "sweep" "sweep_memory_report" nil))))))
+    (unwind-protect
+        (progn
+          (sweeprolog--query-once "sweep" "sweep_set_comment_modes_cache_limit" 1)
+          (let ((hits (funcall stat "Hits"))
+                (evictions (funcall stat "Evictions")))
+            (should (equal (sweeprolog-local-predicate-export-comment "foo" 1 "/")
+                           "+Bar"))
+            (should (equal (sweeprolog-local-predicate-export-comment "foo" 1 "/")
+                           "+Bar"))
+            (should (= (funcall stat "Hits") (1+ hits)))
+            (should (equal (sweeprolog-local-predicate-export-comment "baz" 1 "/")
+                           "-Qux"))
+            (should (< evictions (funcall stat "Evictions")))))
+      (sweeprolog--query-once "sweep" "sweep_set_comment_modes_cache_limit" 512))))
+
+(ert-deftest html-documentation-prewarm ()
+  "Test rendering documentation for imported modules in the background."
+  (let ((file (make-temp-file "sweeprolog-test" nil ".pl"
+                              ":- use_module(library(lists)).\n")))
+    (sweeprolog--query-once "sweep" "sweep_html_documentation_prewarm"
+                            (list file))
+    (with-timeout (10 (error "Prewarming documentation timed out"))
+      (while (not (seq-find (lambda (row)
+                              (equal (seq-take row 2)
+                                     (list "Caches"
+                                           "sweep_html_documentation_cache/3")))
+                            (sweeprolog--query-once
+                             "sweep" "sweep_memory_report" nil)))
+        (sleep-for 0.1)))
+    (let ((html (sweeprolog--query-once "sweep"
+                                        "sweep_predicate_html_documentation"
+                                        "lists:member/2")))
+      (should (string-match-p "member" html))
+      (should (eq (sweeprolog-render-html html)
+                  (sweeprolog-render-html html))))))
+
+(sweeprolog-deftest message-batch-limit ()
+  "Test logging Prolog messages in rate limited batches."
+  "
+:- forall(between(1, 5, N),
+          print_message(warning, format(\"sweeprolog test message ~w\", [N]))).
+"
+  (sweeprolog-messages-flush)
+  (unwind-protect
+      (progn
+        (sweeprolog--query-once "sweep" "sweep_set_message_limit" 2)
+        (sweeprolog-load-buffer (current-buffer))
+        (with-current-buffer (get-buffer-create sweeprolog-messages-buffer-name)
+          (let ((start (point-max)))
+            (sweeprolog-messages-flush)
+            (let ((logged (buffer-substring-no-properties start (point-max))))
+              (should (= (how-many "sweeprolog test message" start (point-max)) 2))
+              (should (string-match-p "WARNING: sweeprolog test message 1" logged))
+              (should (string-match-p "3 more messages suppressed" logged))))))
+    (sweeprolog--query-once "sweep" "sweep_set_message_limit"
+                            sweeprolog-messages-limit)))
+
+(sweeprolog-deftest load-buffer-unchanged ()
+  "Test skipping loads of unchanged buffer contents."
+  "
+:- module(loadbufferunchanged, [foo/1]).
+
+foo(1).
+"
+  (let ((spec (list (buffer-string) (float-time) (buffer-file-name) nil t)))
+    (let ((result (sweeprolog--query-once "sweep" "sweep_load_buffer" spec)))
+      (should (equal (car result) "compiled"))
+      (should (numberp (cdr result))))
+    (should (equal (car (sweeprolog--query-once "sweep" "sweep_load_buffer" spec))
+                   "unchanged"))
+    (should (equal (car (sweeprolog--query-once
+                         "sweep" "sweep_load_buffer"
+                         (list (buffer-string) (float-time) (buffer-file-name) nil nil)))
+                   "compiled"))
+    (goto-char (point-max))
+    (insert "foo(2).\n")
+    (should (equal (car (sweeprolog--query-once
+                         "sweep" "sweep_load_buffer"
+                         (list (buffer-string) (float-time) (buffer-file-name) nil t)))
+                   "compiled"))))
+
+(sweeprolog-deftest reconsult-buffer ()
+  "Test recompiling only the predicates that changed in a buffer."
+  "
+:- module(reconsultbuffer, []).
+
+:- dynamic foo/2.
+
+foo(_, 1).
+
+bar(_, 1).
+"
+  (let ((spec (lambda ()
+                (list (buffer-string) (float-time) (buffer-file-name)))))
+    (should (equal (car (sweeprolog--query-once "sweep" "sweep_reconsult_buffer"
+                                                (funcall spec)))
+                   "loaded"))
+    (should (= (sweeprolog--query-once "reconsultbuffer" "foo" nil) 1))
+    (goto-char (point-min))
+    (search-forward "foo(_, 1)")
+    (replace-match "foo(_, 2)")
+    (should (equal (seq-take (sweeprolog--query-once
+                              "sweep" "sweep_reconsult_buffer"
+                              (funcall spec))
+                             2)
+                   '("reconsulted" 1)))
+    (should (= (sweeprolog--query-once "reconsultbuffer" "foo" nil) 2))
+    (should (= (sweeprolog--query-once "reconsultbuffer" "bar" nil) 1))
+    (goto-char (point-max))
+    (insert ":- dynamic baz/1.\n")
+    (should (equal (car (sweeprolog--query-once "sweep" "sweep_reconsult_buffer"
+                                                (funcall spec)))
+                   "loaded"))))
+
+(sweeprolog-deftest reconsult-buffer-static ()
+  "Test reconsulting a buffer after deleting a static predicate."
+  "
+:- module(reconsultbufferstatic, []).
+
+has_bar(_, B) :- ( current_predicate(bar/2) -> B = 1 ; B = 0 ).
+
+bar(_, 1).
+"
+  (let ((spec (lambda ()
+                (list (buffer-string) (float-time) (buffer-file-name)))))
+    (should (equal (car (sweeprolog--query-once "sweep" "sweep_reconsult_buffer"
+                                                (funcall spec)))
+                   "loaded"))
+    (should (= (sweeprolog--query-once "reconsultbufferstatic" "has_bar" nil) 1))
+    (goto-char (point-min))
+    (search-forward "bar(_, 1).")
+    (replace-match "")
+    (should (equal (car (sweeprolog--query-once "sweep" "sweep_reconsult_buffer"
+                                                (funcall spec)))
+                   "loaded"))
+    (should (= (sweeprolog--query-once "reconsultbufferstatic" "has_bar" nil) 0))))
+
+(sweeprolog-deftest breakpoints-in-region ()
+  "Test querying breakpoints by region as they are set and deleted."
+  "
+:- module(breakpointsinregion, []).
+
+foo :- true, bar.
+
+bar.
+"
+  (sweeprolog-load-buffer (current-buffer))
+  (should-not (sweeprolog-current-breakpoints-in-region (point-min) (point-max)))
+  (goto-char (point-min))
+  (search-forward "bar.")
+  (let* ((beg (match-beginning 0))
+         (id (sweeprolog--query-once "sweep" "sweep_set_breakpoint"
+                                     (list (buffer-file-name)
+                                           (line-number-at-pos beg)
+                                           (1- beg)))))
+    (should id)
+    (should (equal (sweeprolog-current-breakpoints-in-region (point-min) (point-max))
+                   (list (cons beg (+ beg 3)))))
+    (should-not (sweeprolog-current-breakpoints-in-region (1+ beg) (point-max)))
+    (let ((bps (sweeprolog-breakpoints-at-point (buffer-file-name) (1+ beg))))
+      (should (= (length bps) 1))
+      (should (equal (alist-get "id" (car bps) nil nil #'string=) id))
+      (should (equal (alist-get "clause" (car bps) nil nil #'string=) 1)))
+    (should-not (sweeprolog-breakpoints-at-point (buffer-file-name) (point-max)))
+    (sweeprolog--query-once "sweep" "sweep_delete_breakpoint" id)
+    (should-not (sweeprolog-current-breakpoints-in-region (point-min) (point-max)))
+    (should-not (sweeprolog-breakpoints-at-point (buffer-file-name) (1+ beg)))))
+
+(sweeprolog-deftest functors-page ()
+  "Test paging through functors that start with a given prefix."
+  "
+:- module(functorspage, []).
+
+sweepfunctorpagea(_, _, _).
+sweepfunctorpageb(_, _).
+sweepfunctorpagea.
+"
+  (sweeprolog-load-buffer (current-buffer))
+  (should (equal (sweeprolog-functors-page "sweepfunctorpage" 3 0 10)
+                 '(("sweepfunctorpagea" . 3))))
+  (let ((all (sweeprolog-functors-page "sweepfunctorpage" nil 0 10)))
+    (should (member '("sweepfunctorpageb" . 2) all))
+    (should (equal all (sort (copy-sequence all)
+                             (lambda (a b) (string< (car a) (car b))))))
+    (should (equal (append (sweeprolog-functors-page "sweepfunctorpage" nil 0 1)
+                           (sweeprolog-functors-page "sweepfunctorpage" nil 1 10))
+                   all)))
+  (should-not (sweeprolog-functors-page "sweepfunctorpagez" nil 0 10)))
+
+(sweeprolog-deftest missing-dependencies-cached ()
+  "Test caching missing dependencies along with their library specs."
+  "
+:- module(missingdepscached, [bar/1]).
+
+bar(X) :- permutation(X, [1,2,3]).
+"
+  (let ((deps (sweeprolog--query-once "sweep" "sweep_file_missing_dependencies"
+                                      (buffer-file-name))))
+    (should (equal (mapcar (lambda (dep) (list (nth 1 dep) (nth 3 dep))) deps)
+                   '(("permutation/2" "library(lists)"))))
+    (should (equal (sweeprolog--query-once "sweep" "sweep_file_missing_dependencies"
+                                           (buffer-file-name))
+                   deps))))
+
+(ert-deftest dependency-graph ()
+  "Test the module dependency graph."
+  (let* ((dir (file-name-as-directory
+               (file-truename (make-temp-file "sweeprolog-test" t))))
+         (foo (expand-file-name "depgraphfoo.pl" dir))
+         (bar (expand-file-name "depgraphbar.pl" dir))
+         (baz (expand-file-name "depgraphbaz.pl" dir))
+         (qux (expand-file-name "depgraphqux.pl" dir)))
+    (unwind-protect
+        (progn
+          (with-temp-file foo
+            (insert ":- module(depgraphfoo, [foo/0]).\n"
+                    ":- use_module(depgraphbar).\n"
+                    ":- use_module(depgraphbaz).\n"
+                    ":- use_module(depgraphqux).\n"
+                    "foo :- bar.\n"))
+          (with-temp-file bar
+            (insert ":- module(depgraphbar, [bar/0]).\n"
+                    ":- use_module(depgraphfoo).\n"
+                    "bar :- foo.\n"))
+          (with-temp-file baz
+            (insert ":- module(depgraphbaz, [baz/0]).\n"
+                    "baz.\n"))
+          (with-temp-file qux
+            (insert ":- module(depgraphqux, [op(700, xfx, ===>)]).\n"))
+          (dolist (file (list foo bar baz))
+            (sweeprolog--query-once "sweep" "sweep_xref_source" file))
+          (should (equal (sweeprolog--query-once
+                          "sweep" "sweep_predicate_dependencies"
+                          (cons foo bar))
+                         '("bar/0")))
+          (should (equal (sweeprolog--query-once
+                          "sweep" "sweep_unused_dependencies" foo)
+                         (list baz)))
+          (should (equal (sweeprolog--query-once
+                          "sweep" "sweep_dependency_cycles" dir)
+                         (list (sort (list foo bar) #'string<))))
+          (let ((dot (sweeprolog--query-once
+                      "sweep" "sweep_dependency_graph_dot" dir)))
+            (should (string-match-p
+                     (regexp-quote (format "\"%s\" -> \"%s\" [label=\"bar/0\"];"
+                                           foo bar))
+                     dot))
+            (should (string-match-p
+                     (regexp-quote (format "\"%s\" -> \"%s\" [style=dashed];"
+                                           foo baz))
+                     dot))))
+      (delete-directory dir t))))
+
+(sweeprolog-deftest scan-tokens-agree-with-index ()
+  "Test that scanning for tokens agrees with the token index."
+  "foo('a b'(X), Y) :- Y is -1 + X.
+"
+  (sweeprolog--token-index-ensure (point-min))
+  (let ((indexed (append (nth 3 sweeprolog--token-index) nil))
+        (pos (point-min))
+        (scanned nil))
+    (should (equal indexed
+                   '((functor 1 5) (string 5 10) (open 10 11) (symbol 11 12)
+                     (close 12 13) (operator 13 14) (symbol 15 16)
+                     (close 16 17) (operator 18 20) (symbol 21 22)
+                     (symbol 23 25) (operator 26 27) (symbol 27 28)
+                     (operator 29 30) (symbol 31 32) (operator 32 33))))
+    (dotimes (_ (length indexed))
+      (let ((token (sweeprolog--scan-next-token pos)))
+        (push token scanned)
+        (setq pos (nth 2 token))))
+    (should (equal (nreverse scanned) indexed))))
+
+(sweeprolog-deftest forward-sexp-stops-at-word-operator ()
+  "Test that scanning forward over a term stops at `is'."
+  "foo :- X is Y + 1, bar.
+"
+  (setq sweeprolog--token-index nil)
+  (goto-char 8)
+  (sweeprolog--forward-sexp)
+  (should (= (point) 9))
+  (goto-char 10)
+  (sweeprolog--forward-sexp)
+  (should (= (point) 18))
+  (goto-char 9)
+  (sweeprolog--backward-sexp)
+  (should (= (point) 8)))
+
 
 ;;; sweeprolog-tests.el ends here
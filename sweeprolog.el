@@ -45,6 +45,10 @@
 
 (defvar sweeprolog-prolog-server-port nil)
 
+(defvar sweeprolog-prolog-server-socket nil)
+
+(defvar sweeprolog--messages-timer nil)
+
 (defvar sweeprolog-read-predicate-history nil)
 
 (defvar sweeprolog-read-module-history nil)
@@ -188,6 +192,32 @@ locate its \"home\" directory.  Otherwise, Sweep uses
   :package-version '((sweeprolog . "0.23.1"))
   :type 'string)
 
+(defcustom sweeprolog-messages-flush-interval 0.5
+  "Number of seconds between updates of the Sweep messages buffer.
+
+Prolog queues the messages that it emits, and Sweep inserts them
+into the buffer `sweeprolog-messages-buffer-name' in batches at
+this interval.  Sweep only queries Prolog when there are queued
+messages."
+  :package-version '((sweeprolog "0.28.0"))
+  :type 'number)
+
+(defcustom sweeprolog-messages-limit 1000
+  "Maximum number of Prolog messages to log per update.
+
+Sweep logs at most this many Prolog messages every
+`sweeprolog-messages-flush-interval' seconds, and counts further
+messages without logging them.  If this is nil, Sweep logs all
+messages."
+  :package-version '((sweeprolog "0.28.0"))
+  :type '(choice (natnum :tag "Maximum number of messages")
+                 (const  :tag "Unlimited" nil))
+  :set (lambda (symbol value)
+         (set-default symbol value)
+         (when (bound-and-true-p sweeprolog--initialized)
+           (sweeprolog--query-once "sweep" "sweep_set_message_limit"
+                                   value))))
+
 (defcustom sweeprolog-read-flag-prompt "Flag: "
   "Prompt used for reading a Prolog flag name from the minibuffer."
   :package-version '((sweeprolog . "0.1.2"))
@@ -445,6 +475,44 @@ pack completion candidates."
   :package-version '((sweeprolog "0.22.2"))
   :type 'natnum)
 
+(defcustom sweeprolog-load-buffer-skip-unchanged nil
+  "Whether `sweeprolog-load-buffer' skips loading unchanged contents.
+
+If this is non-nil, `sweeprolog-load-buffer' does nothing when the
+contents of the buffer are the same as the last time it loaded
+them and nothing else reloaded its file since.  If this is nil, as
+it is by default, `sweeprolog-load-buffer' always loads the buffer,
+for example to run its directives and initialization goals again."
+  :package-version '((sweeprolog "0.28.0"))
+  :type 'boolean)
+
+(defcustom sweeprolog-load-buffer-use-qlf nil
+  "Whether `sweeprolog-load-buffer' loads unmodified files via QLF.
+
+If this is non-nil and the buffer that you load has no unsaved
+changes, `sweeprolog-load-buffer' loads its file through a Quick
+Load File (\".qlf\") next to the source file, creating or updating
+it as needed.  This makes reloading large files, such as files
+with many facts, much faster."
+  :package-version '((sweeprolog "0.28.0"))
+  :type 'boolean)
+
+(defcustom sweeprolog-read-functor-limit 1000
+  "Maximum number of functor completion candidates to fetch at once.
+
+`sweeprolog-read-functor' asks Prolog only for functors that start
+with the text you have typed so far, and takes at most this many
+of them as completion candidates.  Type a longer prefix to narrow
+down the candidates further.
+
+This only applies when all of your `completion-styles' match
+candidates by prefix.  With other styles, such as `substring',
+`flex' or `orderless', `sweeprolog-read-functor' fetches all
+functors up front instead, since these styles can match a
+candidate that doesn't start with the minibuffer input."
+  :package-version '((sweeprolog "0.28.0"))
+  :type 'natnum)
+
 (defcustom sweeprolog-top-level-use-pty
   (not (memq system-type '(ms-dos windows-nt)))
   "Whether to communicate with top-levels using pseudo-terminal (\"pty\").
@@ -453,6 +521,77 @@ By default, this is t on systems where Emacs can use a pty."
   :package-version '((sweeprolog "0.25.0"))
   :type 'boolean)
 
+(defcustom sweeprolog-top-level-transport nil
+  "How top-level buffers communicate with their Prolog threads.
+
+This is one of the symbols `pty', `local' and `tcp', or nil.
+`pty' says to use a pseudo-terminal, `local' says to connect via
+a Unix-domain socket in a private temporary directory, and `tcp'
+says to connect via a TCP socket on localhost.  nil means to use
+a pty if `sweeprolog-top-level-use-pty' is non-nil, and TCP
+otherwise."
+  :package-version '((sweeprolog "0.28.0"))
+  :type '(choice (const :tag "Pseudo-terminal" pty)
+                 (const :tag "Unix-domain socket" local)
+                 (const :tag "TCP on localhost" tcp)
+                 (const :tag "Per sweeprolog-top-level-use-pty" nil)))
+
+(defcustom sweeprolog-xref-cache-max-sources 256
+  "Maximum number of source files to keep cross reference data for.
+
+Sweep cross references each file that you visit, as well as
+library files that it looks into, for example to find predicate
+definitions.  When the number of cross referenced files exceeds
+this limit, Sweep discards the data of the least recently used
+files, and recomputes it if it needs it again.  Sweep also
+discards the cross reference data of a file when you kill its
+buffer.
+
+If this is nil, Sweep keeps cross reference data indefinitely."
+  :package-version '((sweeprolog "0.28.0"))
+  :type '(choice (natnum :tag "Maximum number of files")
+                 (const  :tag "Unlimited" nil))
+  :set (lambda (symbol value)
+         (set-default symbol value)
+         (when (bound-and-true-p sweeprolog--initialized)
+           (sweeprolog--query-once "sweep" "sweep_set_xref_cache_limit"
+                                   value))))
+
+(defcustom sweeprolog-async-goal-workers 2
+  "Number of Prolog threads that Sweep keeps for running async goals.
+
+Sweep runs async goals, such as those of `sweeprolog-async-goal',
+on a pool of worker threads that it reuses from goal to goal.
+When all of these threads are busy, Sweep starts an extra thread
+for a new goal, and that thread exits once there are no more
+goals waiting."
+  :package-version '((sweeprolog "0.28.0"))
+  :type 'natnum
+  :set (lambda (symbol value)
+         (set-default symbol value)
+         (when (bound-and-true-p sweeprolog--initialized)
+           (sweeprolog--set-async-pool))))
+
+(defcustom sweeprolog-async-goal-stack-limit nil
+  "Stack limit in bytes of Prolog threads that run async goals.
+
+If this is nil, these threads use the default stack limit of the
+Prolog runtime."
+  :package-version '((sweeprolog "0.28.0"))
+  :type '(choice (natnum :tag "Stack limit in bytes")
+                 (const  :tag "Default" nil))
+  :set (lambda (symbol value)
+         (set-default symbol value)
+         (when (bound-and-true-p sweeprolog--initialized)
+           (sweeprolog--set-async-pool))))
+
+(defun sweeprolog--set-async-pool ()
+  "Configure the Prolog worker pool that runs async goals."
+  (sweeprolog--query-once "sweep" "sweep_set_async_pool"
+                          (cons sweeprolog-async-goal-workers
+                                (bound-and-true-p
+                                 sweeprolog-async-goal-stack-limit))))
+
 
 ;;;; Keymaps
 
@@ -656,6 +795,13 @@ By default, this is t on systems where Emacs can use a pty."
 (declare-function sweeprolog-cut-query     "sweep-module")
 (declare-function sweeprolog-close-query   "sweep-module")
 (declare-function sweeprolog-cleanup       "sweep-module")
+(declare-function sweeprolog-messages-pending-p "sweep-module")
+(declare-function sweeprolog-profile-enable "sweep-module")
+(declare-function sweeprolog-profile-data  "sweep-module")
+(declare-function sweeprolog-callback-trace-enable "sweep-module")
+(declare-function sweeprolog-callback-trace-data   "sweep-module")
+(declare-function sweeprolog-callback-trace-events "sweep-module")
+(declare-function json-encode "json")
 
 
 ;;;; Initialization
@@ -713,7 +859,10 @@ extra initialization arguments."
     (setq sweeprolog--initialized t)
     (add-hook 'kill-emacs-query-functions #'sweeprolog-maybe-kill-top-levels)
     (add-hook 'kill-emacs-hook #'sweeprolog--shutdown)
-    (sweeprolog-setup-message-hook)))
+    (sweeprolog-setup-message-hook)
+    (sweeprolog--query-once "sweep" "sweep_set_xref_cache_limit"
+                            sweeprolog-xref-cache-max-sources)
+    (sweeprolog--set-async-pool)))
 
 (defun sweeprolog-maybe-kill-top-levels ()
   "Ask before killing running Prolog top-levels."
@@ -734,10 +883,19 @@ extra initialization arguments."
 (defun sweeprolog--shutdown ()
   "Shutdown Prolog."
   (message "Stopping Sweep.")
+  (when sweeprolog--messages-timer
+    (cancel-timer sweeprolog--messages-timer)
+    (setq sweeprolog--messages-timer nil))
   (sweeprolog--query-once "sweep" "sweep_cleanup_threads" nil)
   (sweeprolog-cleanup)
-  (setq sweeprolog--initialized       nil
-        sweeprolog-prolog-server-port nil))
+  (when sweeprolog-prolog-server-socket
+    (ignore-errors
+      (delete-directory (file-name-directory
+                         sweeprolog-prolog-server-socket)
+                        t)))
+  (setq sweeprolog--initialized         nil
+        sweeprolog-prolog-server-port   nil
+        sweeprolog-prolog-server-socket nil))
 
 (defun sweeprolog-shutdown ()
   "Ask before killing running top-levels and shutdown Prolog."
@@ -796,12 +954,28 @@ the order of the arguments is reversed."
   (setq sweeprolog-prolog-server-port
         (sweeprolog--query-once "sweep" "sweep_top_level_server" nil)))
 
+(defun sweeprolog-start-prolog-local-server ()
+  "Start the Sweep top-level server on a Unix-domain socket."
+  (setq sweeprolog-prolog-server-socket
+        (sweeprolog--query-once "sweep" "sweep_top_level_local_server"
+                                (expand-file-name
+                                 "top-level"
+                                 (make-temp-file "sweeprolog" t)))))
+
 (defun sweeprolog-setup-message-hook ()
   "Setup `thread_message_hook/3' to redirecet Prolog messages."
   (with-current-buffer (get-buffer-create sweeprolog-messages-buffer-name)
     (setq-local window-point-insertion-type t)
     (compilation-minor-mode 1))
-  (sweeprolog--query-once "sweep" "sweep_setup_message_hook" nil))
+  (sweeprolog--query-once "sweep" "sweep_setup_message_hook" nil)
+  (sweeprolog--query-once "sweep" "sweep_set_message_limit"
+                          sweeprolog-messages-limit)
+  (when sweeprolog--messages-timer
+    (cancel-timer sweeprolog--messages-timer))
+  (setq sweeprolog--messages-timer
+        (run-with-timer sweeprolog-messages-flush-interval
+                        sweeprolog-messages-flush-interval
+                        #'sweeprolog-messages-flush)))
 
 
 ;;;; Prolog messages
@@ -809,39 +983,55 @@ the order of the arguments is reversed."
 (defun sweeprolog-view-messages ()
   "View the log of recent Prolog messages."
   (interactive)
+  (sweeprolog-messages-flush)
   (with-current-buffer (get-buffer-create sweeprolog-messages-buffer-name)
     (goto-char (point-max))
     (let ((win (display-buffer (current-buffer))))
       (set-window-point win (point))
       win)))
 
-(defun sweeprolog-message (message)
-  "Emit the Prolog message MESSAGE to the Sweep messages buffer."
-  (with-current-buffer (get-buffer-create sweeprolog-messages-buffer-name)
-    (save-excursion
-      (goto-char (point-max))
-      (let ((kind (car message))
-            (content (cdr message)))
-        (pcase kind
-          (`("debug" . ,topic)
-           (insert (propertize "DEBUG" 'face 'sweeprolog-debug-prefix))
-           (insert "[")
-           (insert (propertize topic 'face 'sweeprolog-debug-topic))
-           (insert "]: ")
-           (insert content))
-          ("informational"
-           (insert (propertize "INFO" 'face 'sweeprolog-info-prefix))
-           (insert ": ")
-           (insert content))
-          ("warning"
-           (insert (propertize "WARNING" 'face 'sweeprolog-warning-prefix))
-           (insert ": ")
-           (insert content))
-          ("error"
-           (insert (propertize "ERROR" 'face 'sweeprolog-error-prefix))
-           (insert ": ")
-           (insert content))))
-      (newline))))
+(defun sweeprolog-messages-flush ()
+  "Log the Prolog messages that are queued for the messages buffer.
+This only queries Prolog if it queued messages since the last flush."
+  (when (and sweeprolog--initialized
+             (sweeprolog-messages-pending-p))
+    (pcase (sweeprolog--query-once "sweep" "sweep_message_batch" nil)
+      (`(0) nil)
+      (`(,suppressed . ,messages)
+       (with-current-buffer (get-buffer-create sweeprolog-messages-buffer-name)
+         (save-excursion
+           (goto-char (point-max))
+           (dolist (message messages)
+             (sweeprolog--insert-message message))
+           (unless (zerop suppressed)
+             (insert (propertize "INFO" 'face 'sweeprolog-info-prefix)
+                     (format ": %d more messages suppressed" suppressed))
+             (newline))))))))
+
+(defun sweeprolog--insert-message (message)
+  "Insert the Prolog message MESSAGE at point."
+  (let ((kind (car message))
+        (content (cdr message)))
+    (pcase kind
+      (`("debug" . ,topic)
+       (insert (propertize "DEBUG" 'face 'sweeprolog-debug-prefix))
+       (insert "[")
+       (insert (propertize topic 'face 'sweeprolog-debug-topic))
+       (insert "]: ")
+       (insert content))
+      ("informational"
+       (insert (propertize "INFO" 'face 'sweeprolog-info-prefix))
+       (insert ": ")
+       (insert content))
+      ("warning"
+       (insert (propertize "WARNING" 'face 'sweeprolog-warning-prefix))
+       (insert ": ")
+       (insert content))
+      ("error"
+       (insert (propertize "ERROR" 'face 'sweeprolog-error-prefix))
+       (insert ": ")
+       (insert content))))
+  (newline))
 
 
 ;;;; Flags
@@ -988,6 +1178,16 @@ depends on the value of the user option
   "Return a list of predicates whose name resembeles PATTERN."
   (sweeprolog--query-once "sweep" "sweep_predicate_apropos" pattern))
 
+(defun sweeprolog-functors-page (prefix arity offset limit)
+  "Return at most LIMIT functors whose name starts with PREFIX.
+
+Skip the first OFFSET matching functors.  If ARITY is non-nil,
+only consider functors with arity ARITY.  Return a list of cons
+cells (NAME . ARITY), where NAME is the quoted functor name as a
+string, sorted by NAME."
+  (cdr (sweeprolog--query-once "sweep" "sweep_functors_page"
+                               (list prefix arity offset limit))))
+
 (defun sweeprolog-read-functor (&optional arity)
   "Read a Prolog functor/arity pair from the minibuffer.
 
@@ -996,16 +1196,37 @@ Otherwise, read only the functor, with completion candidates are
 restricted to functors with arity ARITY, and return ARITY as the
 arity.
 
-Return a cons cell of the functor as a string and the arity."
-  (let* ((col (sweeprolog--query-once "sweep" "sweep_current_functors"
-                                      arity))
+Return a cons cell of the functor as a string and the arity.
+
+If all of `completion-styles' match by prefix, completion
+candidates are the first `sweeprolog-read-functor-limit' functors
+that start with the minibuffer input.  Otherwise, all functors are
+candidates."
+  (let* ((arities (make-hash-table :test #'equal))
+         (table
+          (if (seq-every-p (lambda (style)
+                             (memq style '(basic partial-completion
+                                                 emacs21 emacs22)))
+                           completion-styles)
+              (completion-table-dynamic
+               (lambda (prefix)
+                 (mapcar (lambda (functor)
+                           (puthash (car functor) (cdr functor) arities)
+                           (car functor))
+                         (sweeprolog-functors-page
+                          prefix arity 0 sweeprolog-read-functor-limit))))
+            (mapcar (lambda (functor)
+                      (puthash (car functor) (cdr functor) arities)
+                      (car functor))
+                    (sweeprolog--query-once "sweep" "sweep_current_functors"
+                                            arity))))
          (completion-extra-properties
           (list :annotation-function
                 (lambda (key)
-                  (when-let ((val (cdr (assoc-string key col))))
+                  (when-let ((val (gethash key arities)))
                     (concat "/" (number-to-string val)))))))
     (let ((functor (completing-read "Functor: "
-                                    col nil nil nil
+                                    table nil nil nil
                                     'sweeprolog-read-functor-history)))
       (cons functor
             (or arity (read-number (concat functor "/")))))))
@@ -3252,6 +3473,14 @@ inside a comment, string or quoted atom."
   (when-let ((fn (buffer-file-name)))
     (sweeprolog--query-once "sweep" "sweep_xref_source" fn)))
 
+(defun sweeprolog-xref-release ()
+  "Discard the cross reference data of the current buffer's file."
+  (when-let ((fn (buffer-file-name)))
+    (when sweeprolog--initialized
+      (condition-case _
+          (sweeprolog--query-once "sweep" "sweep_xref_release" fn)
+        (prolog-exception nil)))))
+
 (defun sweeprolog-analyze-fragment (frag)
   (let* ((beg (max (point-min) (car frag)))
          (end (min (point-max) (+ beg (cadr frag))))
@@ -3279,6 +3508,7 @@ modified."
   (interactive (list t))
   (when (or force sweeprolog--buffer-modified)
     (sweeprolog-xref-buffer)
+    (sweeprolog--op-table-refresh)
     (without-restriction
       (let ((sweeprolog--analyze-point (point)))
         (sweeprolog-analyze-region (point-min) (point-max))))
@@ -3490,6 +3720,17 @@ function with PROC and MSG."
       (delete-process process)
       (sweeprolog--query-once "sweep" "sweep_nohup" 0))))
 
+(defun sweeprolog-top-level--transport ()
+  "Return the transport that new top-level buffers should use.
+
+See `sweeprolog-top-level-transport'."
+  (pcase sweeprolog-top-level-transport
+    ('local (if (featurep 'make-network-process '(:family local))
+                'local
+              'tcp))
+    ('nil (if sweeprolog-top-level-use-pty 'pty 'tcp))
+    (transport transport)))
+
 (defun sweeprolog-top-level-buffer (&optional name)
   "Return a Prolog top-level buffer named NAME.
 
@@ -3503,26 +3744,40 @@ top-level."
         (unless (derived-mode-p 'sweeprolog-top-level-mode)
           (sweeprolog-top-level-mode))
         (setq sweeprolog-top-level-thread-id
-              (if sweeprolog-top-level-use-pty
-                  (progn
-                    (make-comint-in-buffer "sweeprolog-top-level" buf nil)
-                    (let* ((proc (get-buffer-process buf))
-                           (tty (process-tty-name proc)))
-                      (process-send-eof proc)
-                      (prog1 (sweeprolog--query-once
-                              "sweep" "sweep_top_level_start_pty" tty)
-                        (unless comint-last-prompt buf
-                                (accept-process-output proc 1))
-                        (when (eq system-type 'gnu/linux)
-                          ;; make sure the pty does not echo input
-                          (call-process "stty" nil nil nil "-F" tty "-echo")))))
-                (unless sweeprolog-prolog-server-port
-                  (sweeprolog-start-prolog-server))
-                (make-comint-in-buffer "sweeprolog-top-level"
-                                       buf
-                                       (cons "localhost"
-                                             sweeprolog-prolog-server-port))
-                (sweeprolog--query-once "sweep" "sweep_accept_top_level_client" nil)))
+              (pcase (sweeprolog-top-level--transport)
+                ('pty
+                 (make-comint-in-buffer "sweeprolog-top-level" buf nil)
+                 (let* ((proc (get-buffer-process buf))
+                        (tty (process-tty-name proc)))
+                   (process-send-eof proc)
+                   (prog1 (sweeprolog--query-once
+                           "sweep" "sweep_top_level_start_pty" tty)
+                     (unless comint-last-prompt buf
+                             (accept-process-output proc 1))
+                     (when (eq system-type 'gnu/linux)
+                       ;; make sure the pty does not echo input
+                       (call-process "stty" nil nil nil "-F" tty "-echo")))))
+                ('local
+                 (unless (and sweeprolog-prolog-server-socket
+                              (file-exists-p sweeprolog-prolog-server-socket))
+                   (sweeprolog-start-prolog-local-server))
+                 (set-marker (process-mark
+                              (make-network-process
+                               :name "sweeprolog-top-level"
+                               :buffer buf
+                               :family 'local
+                               :service sweeprolog-prolog-server-socket
+                               :coding 'utf-8-unix))
+                             (point-max))
+                 (sweeprolog--query-once "sweep" "sweep_accept_top_level_local_client" nil))
+                (_
+                 (unless sweeprolog-prolog-server-port
+                   (sweeprolog-start-prolog-server))
+                 (make-comint-in-buffer "sweeprolog-top-level"
+                                        buf
+                                        (cons "localhost"
+                                              sweeprolog-prolog-server-port))
+                 (sweeprolog--query-once "sweep" "sweep_accept_top_level_client" nil))))
         (let ((proc (get-buffer-process buf)))
           (set-process-filter proc #'sweeprolog-top-level-filter)
           (unless comint-last-prompt buf (accept-process-output proc 1))
@@ -3696,7 +3951,11 @@ GOAL.  Otherwise, GOAL is set to a default value specified by
 Interactively, if the major mode of the current buffer is
 `sweeprolog-mode' and the command is called without a prefix argument,
 load the current buffer.  Otherwise, prompt for a `sweeprolog-mode'
-buffer to load."
+buffer to load.
+
+If `sweeprolog-load-buffer-skip-unchanged' is non-nil, skip
+loading when the contents of BUFFER did not change since the last
+time this command loaded them."
   (interactive (list
                 (if (and (not current-prefix-arg)
                          (derived-mode-p 'sweeprolog-mode))
@@ -3715,16 +3974,81 @@ buffer to load."
       (let* ((beg (point-min))
              (end (point-max))
              (contents (buffer-substring-no-properties beg end)))
-        (if (sweeprolog--query-once "sweep" "sweep_load_buffer"
-                                    (list contents
-                                          (or sweeprolog--buffer-last-modified-time
-                                              (float-time))
-                                          (or (buffer-file-name)
-                                              (expand-file-name (buffer-name)))))
-            (progn
-              (message "Loaded %s." (buffer-name))
-              (force-mode-line-update))
-          (user-error "Loading %s failed!" (buffer-name)))))))
+        (pcase (sweeprolog--query-once "sweep" "sweep_load_buffer"
+                                       (list contents
+                                             (or sweeprolog--buffer-last-modified-time
+                                                 (float-time))
+                                             (or (buffer-file-name)
+                                                 (expand-file-name (buffer-name)))
+                                             (and sweeprolog-load-buffer-use-qlf
+                                                  (not (buffer-modified-p))
+                                                  t)
+                                             (and sweeprolog-load-buffer-skip-unchanged
+                                                  t)))
+          (`("unchanged" . ,_)
+           (message "Buffer %s already loaded." (buffer-name))
+           (force-mode-line-update))
+          (`(,status . ,seconds)
+           (message "Loaded %s%s in %.3f seconds."
+                    (buffer-name)
+                    (if (equal status "qlf") " via QLF" "")
+                    seconds)
+           (force-mode-line-update))
+          (_ (user-error "Loading %s failed!" (buffer-name))))))))
+
+(defun sweeprolog-reconsult-buffer (buffer)
+  "Recompile the predicates that changed in BUFFER since it was last loaded.
+
+This command compares the clauses of each predicate in BUFFER with
+their version from the previous invocation of this command, and
+recompiles only the predicates whose clauses changed, without
+reloading the rest of the buffer.  If this is the first time you
+use this command for BUFFER, if something else reloaded its file
+in the meantime, if its directives changed, or if a predicate that
+changed is not dynamic, this command loads the whole buffer like
+`sweeprolog-load-buffer'.  In particular, editing a static predicate
+always reloads the whole buffer.
+
+To recompile a dynamic predicate, this command erases the clauses
+that the buffer's file contributed to it and adds the new ones with
+SWI-Prolog's private `$store_clause/4', which may change between
+SWI-Prolog versions.  Clauses that were added at runtime, for
+example with `assertz/1', stay in place, so the recompiled clauses
+of the file now come after them, and the clause order differs from
+what a full reload would give.
+
+Interactively, if the major mode of the current buffer is
+`sweeprolog-mode' and the command is called without a prefix
+argument, reconsult the current buffer.  Otherwise, prompt for a
+`sweeprolog-mode' buffer to reconsult."
+  (interactive (list
+                (if (and (not current-prefix-arg)
+                         (derived-mode-p 'sweeprolog-mode))
+                    (current-buffer)
+                  (read-buffer "Reconsult buffer: "
+                               (when (derived-mode-p 'sweeprolog-mode)
+                                 (buffer-name))
+                               t
+                               (lambda (b)
+                                 (let ((n (or (and (consp b) (car b)) b)))
+                                   (with-current-buffer n
+                                     (derived-mode-p 'sweeprolog-mode))))))))
+  (with-current-buffer buffer
+    (pcase (sweeprolog--query-once "sweep" "sweep_reconsult_buffer"
+                                   (list (buffer-substring-no-properties
+                                          (point-min) (point-max))
+                                         (or sweeprolog--buffer-last-modified-time
+                                             (float-time))
+                                         (or (buffer-file-name)
+                                             (expand-file-name (buffer-name)))))
+      (`("reconsulted" ,count . ,seconds)
+       (message "Recompiled %d changed predicate%s of %s in %.3f seconds."
+                count (if (= count 1) "" "s") (buffer-name) seconds)
+       (force-mode-line-update))
+      (`(,_ ,_ . ,seconds)
+       (message "Loaded %s in %.3f seconds." (buffer-name) seconds)
+       (force-mode-line-update))
+      (_ (user-error "Reconsulting %s failed!" (buffer-name))))))
 
 
 ;;;; Prolog file specifications
@@ -4546,9 +4870,85 @@ work."
 
 (defsubst sweeprolog--op-p (beg end)
   "Check if there is an operator between BEG and END in the current buffer."
-  (sweeprolog--query-once
-   "sweep" "sweep_op_info"
-   (cons (buffer-substring-no-properties beg end) (buffer-file-name))))
+  (unless sweeprolog--op-table
+    (sweeprolog--op-table-refresh))
+  (and sweeprolog--op-table
+       (gethash (buffer-substring-no-properties beg end)
+                sweeprolog--op-table)
+       t))
+
+(defvar-local sweeprolog--token-index nil
+  "Token index of the top term in which term motion last occurred.
+
+This is either nil or a list (TICK BEG END TOKENS), where TICK is
+the value of `buffer-chars-modified-tick' when the index was
+built, BEG and END are the boundaries of the top term, and TOKENS
+is a vector of the tokens of the term, in the format that
+`sweeprolog-next-token-boundaries' returns, ordered by position.")
+
+(defun sweeprolog--token-index-ensure (&optional pos)
+  "Index the tokens of the top term at POS, unless already indexed.
+
+The index lets `sweeprolog-next-token-boundaries' and
+`sweeprolog-last-token-boundaries' find tokens by binary search,
+instead of scanning the buffer.  It stays valid until the buffer
+text changes."
+  (setq pos (or pos (point)))
+  (unless (sweeprolog--token-index-tokens pos)
+    (save-excursion
+      (goto-char pos)
+      (unless (sweeprolog-at-beginning-of-top-term-p)
+        (sweeprolog-beginning-of-top-term))
+      (let ((start (point)))
+        (sweeprolog-end-of-top-term)
+        (when (<= start pos (point))
+          (setq sweeprolog--token-index
+                (list (buffer-chars-modified-tick)
+                      start
+                      (point)
+                      (vconcat
+                       (mapcar (lambda (token)
+                                 (cons (intern (car token)) (cdr token)))
+                               (sweeprolog--query-once
+                                "sweep" "sweep_term_tokens"
+                                (list (buffer-substring-no-properties start
+                                                                      (point))
+                                      start)))))))))))
+
+(defun sweeprolog--token-index-tokens (pos)
+  "Return the indexed tokens of the top term around POS, or nil."
+  (pcase sweeprolog--token-index
+    (`(,tick ,beg ,end ,tokens)
+     (and (= tick (buffer-chars-modified-tick))
+          (<= beg pos end)
+          tokens))))
+
+(defun sweeprolog--token-index-search (tokens pos)
+  "Return the index of the first token in TOKENS that ends after POS."
+  (let ((lo 0)
+        (hi (length tokens)))
+    (while (< lo hi)
+      (let ((mid (/ (+ lo hi) 2)))
+        (if (< pos (nth 2 (aref tokens mid)))
+            (setq hi mid)
+          (setq lo (1+ mid)))))
+    lo))
+
+(defun sweeprolog--indexed-next-token (pos)
+  "Return the indexed token after POS, or nil if it is not known."
+  (when-let ((tokens (sweeprolog--token-index-tokens pos))
+             (i (sweeprolog--token-index-search tokens pos))
+             (token (and (< i (length tokens)) (aref tokens i))))
+    (and (<= pos (nth 1 token)) token)))
+
+(defun sweeprolog--indexed-last-token (pos)
+  "Return the indexed token before POS, or nil if it is not known."
+  (when-let ((tokens (sweeprolog--token-index-tokens pos))
+             (i (sweeprolog--token-index-search tokens pos)))
+    (and (< 0 i)
+         (or (= i (length tokens))
+             (<= pos (nth 1 (aref tokens i))))
+         (aref tokens (1- i)))))
 
 (defun sweeprolog-next-token-boundaries (&optional pos)
   "Return a list (KIND BEG END) describing the Prolog token after POS, if any.
@@ -4558,39 +4958,49 @@ KIND is one of `symbol', `functor' `string', `operator', `open',
 
 If there is no token after POS, return nil."
   (let ((point (or pos (point))))
-    (save-excursion
-      (goto-char point)
-      (while (forward-comment 1))
-      (unless (eobp)
-        (let ((beg (point))
-              (syn (sweeprolog-syntax-class-at (point))))
-          (cond
-           ((member syn '(0 12))
-            (skip-syntax-forward "w_")
-            (if (= (sweeprolog-syntax-class-at (point)) 4)
-                (progn
-                  (forward-char)
-                  (list 'functor beg (point)))
-              (list 'symbol beg (point))))
-           ((= syn 7)
-            (unless (nth 8 (syntax-ppss))
-              (forward-char)
-              (while (and (not (eobp)) (nth 3 (syntax-ppss)))
-                (forward-char))
-              (list 'string beg (point))))
-           ((member syn  '(1 9))
-            (skip-syntax-forward ".")
-            (let ((end (point)))
-              (while (and (< beg (point))
-                          (not (sweeprolog--op-p beg (point))))
-                (forward-char -1))
-              (list 'operator beg (if (= beg (point)) end (point)))))
-           ((= syn 4)
-            (list 'open beg (1+ beg)))
-           ((= syn 5)
-            (list 'close beg (1+ beg)))
-           ((= syn 12) nil)
-           (t (list 'else beg (1+ beg)))))))))
+    (or
+     (sweeprolog--indexed-next-token point)
+     (sweeprolog--scan-next-token point))))
+
+(defun sweeprolog--scan-next-token (point)
+  "Scan the buffer for the Prolog token after POINT.
+See `sweeprolog-next-token-boundaries' for the return value."
+  (save-excursion
+    (goto-char point)
+    (while (forward-comment 1))
+    (unless (eobp)
+      (let ((beg (point))
+            (syn (sweeprolog-syntax-class-at (point))))
+        (cond
+         ((member syn '(2 3))
+          (skip-syntax-forward "w_")
+          (if (= (sweeprolog-syntax-class-at (point)) 4)
+              (progn
+                (forward-char)
+                (list 'functor beg (point)))
+            (list 'symbol beg (point))))
+         ((= syn 7)
+          (unless (nth 8 (syntax-ppss))
+            (forward-char)
+            (let ((ppss (syntax-ppss)))
+              (when (nth 3 ppss)
+                ;; Skip to the end of the string in one go.
+                (parse-partial-sexp (point) (point-max)
+                                    nil nil ppss 'syntax-table)))
+            (list 'string beg (point))))
+         ((member syn  '(1 9))
+          (skip-syntax-forward ".")
+          (let ((end (point)))
+            (while (and (< beg (point))
+                        (not (sweeprolog--op-p beg (point))))
+              (forward-char -1))
+            (list 'operator beg (if (= beg (point)) end (point)))))
+         ((= syn 4)
+          (list 'open beg (1+ beg)))
+         ((= syn 5)
+          (list 'close beg (1+ beg)))
+         ((= syn 12) nil)
+         (t (list 'else beg (1+ beg))))))))
 
 (defun sweeprolog-last-token-boundaries (&optional pos)
   "Return a list (KIND BEG END) describing the Prolog token before POS, if any.
@@ -4599,8 +5009,15 @@ KIND is one of `symbol', `functor' `string', `operator', `open',
 `close' and `else'.  BEG and END are the token boundaries.
 
 If there is no token before POS, return nil."
-  (let ((point (or pos (point)))
-        (go t))
+  (let ((point (or pos (point))))
+    (or
+     (sweeprolog--indexed-last-token point)
+     (sweeprolog--scan-last-token point))))
+
+(defun sweeprolog--scan-last-token (point)
+  "Scan the buffer for the Prolog token before POINT.
+See `sweeprolog-last-token-boundaries' for the return value."
+  (let ((go t))
     (save-excursion
       (goto-char point)
       (while (and (not (bobp)) go)
@@ -4829,6 +5246,8 @@ If there is no token before POS, return nil."
                     (signal 'scan-error (cdr error)))))))
 
 (defun sweeprolog-forward-sexp-function (arg)
+  (when (derived-mode-p 'sweeprolog-mode)
+    (sweeprolog--token-index-ensure))
   (let* ((times (abs arg))
          (func  (or (and (not (= arg 0))
                          (< 0 (/ times arg))
@@ -4838,53 +5257,43 @@ If there is no token before POS, return nil."
       (funcall func)
       (setq times (1- times)))))
 
+(defvar-local sweeprolog--op-table nil
+  "Hash table mapping operators to their types and precedences.
+Each value is a list of cons cells (TYPE . PRECEDENCE), in the
+order in which Prolog reports them.")
+
+(defvar-local sweeprolog--op-table-generation nil
+  "Generation of the operator table in `sweeprolog--op-table'.")
+
+(defun sweeprolog--op-table-refresh ()
+  "Update `sweeprolog--op-table' if the operators in effect changed."
+  (when-let ((res (sweeprolog--query-once "sweep" "sweep_op_table"
+                                          (list (buffer-file-name)
+                                                sweeprolog--op-table-generation))))
+    (let ((table (make-hash-table :test #'equal)))
+      (dolist (op (reverse (cdr res)))
+        (pcase op
+          (`(,name ,type . ,pre)
+           (puthash name (cons (cons type pre) (gethash name table)) table))))
+      (setq sweeprolog--op-table table
+            sweeprolog--op-table-generation (car res)))))
+
+(defun sweeprolog--op-precedence (token types)
+  "Return the precedence of TOKEN as an operator of one of TYPES."
+  (unless sweeprolog--op-table
+    (sweeprolog--op-table-refresh))
+  (when sweeprolog--op-table
+    (cdr (seq-find (lambda (entry) (member (car entry) types))
+                   (gethash token sweeprolog--op-table)))))
+
 (defun sweeprolog-op-suffix-precedence (token)
-  (sweeprolog--open-query "user" "sweep" "sweep_op_info" (cons token (buffer-file-name)))
-  (let ((res nil) (go t))
-    (while go
-      (if-let ((sol (sweeprolog-next-solution))
-               (det (car sol))
-               (fix (cadr sol))
-               (pre (cddr sol)))
-          (if (member fix '("xf" "yf"))
-              (setq res pre go nil)
-            (when (eq '! det)
-              (setq go nil)))
-        (setq go nil)))
-    (sweeprolog-close-query)
-    res))
+  (sweeprolog--op-precedence token '("xf" "yf")))
 
 (defun sweeprolog-op-prefix-precedence (token)
-  (sweeprolog--open-query "user" "sweep" "sweep_op_info" (cons token (buffer-file-name)))
-  (let ((res nil) (go t))
-    (while go
-      (if-let ((sol (sweeprolog-next-solution))
-               (det (car sol))
-               (fix (cadr sol))
-               (pre (cddr sol)))
-          (if (member fix '("fx" "fy"))
-              (setq res pre go nil)
-            (when (eq '! det)
-              (setq go nil)))
-        (setq go nil)))
-    (sweeprolog-close-query)
-    res))
+  (sweeprolog--op-precedence token '("fx" "fy")))
 
 (defun sweeprolog-op-infix-precedence (token)
-  (sweeprolog--open-query "user" "sweep" "sweep_op_info" (cons token (buffer-file-name)))
-  (let ((res nil) (go t))
-    (while go
-      (if-let ((sol (sweeprolog-next-solution))
-               (det (car sol))
-               (fix (cadr sol))
-               (pre (cddr sol)))
-          (if (member fix '("xfx" "xfy" "yfx"))
-              (setq res pre go nil)
-            (when (eq '! det)
-              (setq go nil)))
-        (setq go nil)))
-    (sweeprolog-close-query)
-    res))
+  (sweeprolog--op-precedence token '("xfx" "xfy" "yfx")))
 
 (defun sweeprolog-local-predicate-export-comment (fun ari ind)
   (sweeprolog--query-once "sweep" "sweep_local_predicate_export_comment"
@@ -5084,6 +5493,7 @@ certain contexts to maintain conventional Prolog layout."
   (setq-local forward-sexp-function #'sweeprolog-forward-sexp-function)
   (setq-local syntax-propertize-function sweeprolog-syntax-propertize-function)
   (setq-local indent-line-function #'sweeprolog-indent-line)
+  (setq-local indent-region-function #'sweeprolog-indent-region)
   (setq-local adaptive-fill-regexp "[ \t]*")
   (setq-local fill-indent-according-to-mode t)
   (setq-local comment-multi-line t)
@@ -5105,6 +5515,7 @@ certain contexts to maintain conventional Prolog layout."
             #'sweeprolog--update-buffer-last-modified-time nil t)
   (add-hook 'after-change-functions
             #'sweeprolog-analyze-some-terms nil t)
+  (add-hook 'kill-buffer-hook #'sweeprolog-xref-release nil t)
   (when sweeprolog-enable-eldoc
     (when (fboundp 'eldoc-documentation-default)
       (setq-local eldoc-documentation-strategy #'eldoc-documentation-default))
@@ -5264,8 +5675,8 @@ accordingly."
     (goto-char fbeg)
     (+ (current-column) sweeprolog-indent-offset)))
 
-(defun sweeprolog-indent-line-after-term ()
-  (if-let ((open (nth 1 (syntax-ppss))))
+(defun sweeprolog-indent-line-after-term (&optional ppss)
+  (if-let ((open (nth 1 (or ppss (syntax-ppss)))))
       (save-excursion
         (goto-char open)
         (current-column))
@@ -5301,65 +5712,75 @@ accordingly."
             (/ sweeprolog-indent-offset 2)
           col)))))
 
+(defun sweeprolog--indent-column (ppss &optional token)
+  "Return the column to which to indent the line at point.
+
+Point must be at the indentation of the current line, and PPSS
+must be the syntax state at point, as returned by `syntax-ppss'.
+Optional argument TOKEN is the last token before point, as
+returned by `sweeprolog-last-token-boundaries', if the caller
+already knows it.  Return `noindent' if the line should keep its
+current indentation."
+  (if-let ((open (nth 8 ppss)))
+      ;; Inside a comment or a string.
+      (if (nth 4 ppss)
+          ;; It's a comment.  Indent like
+          ;; `indent--default-inside-comment'.
+          (save-excursion
+            (forward-line -1)
+            (skip-chars-forward " \t")
+            (when (< (1- (point)) open (line-end-position))
+              (goto-char open)
+              (when (looking-at comment-start-skip)
+                (goto-char (match-end 0))))
+            (current-column))
+        ;; It's a string.  Don't indent.
+        'noindent)
+    (if-let ((open (and (not (eobp))
+                        (= (sweeprolog-syntax-class-at (point)) 5)
+                        (nth 1 ppss))))
+        (save-excursion
+          (goto-char open)
+          (when (member (sweeprolog-syntax-class-at (1- (point)))
+                        '(2 3))
+            (when (save-excursion
+                    (forward-char)
+                    (skip-syntax-forward " " (pos-eol))
+                    (eolp))
+              (skip-syntax-backward "w_")))
+          (current-column))
+      (pcase (or token (sweeprolog-last-token-boundaries))
+        ('nil 'noindent)
+        (`(functor ,lbeg ,lend)
+         (sweeprolog-indent-line-after-functor lbeg lend))
+        (`(open ,lbeg ,lend)
+         (sweeprolog-indent-line-after-open lbeg lend))
+        (`(symbol ,lbeg ,lend)
+         (let ((sym (buffer-substring-no-properties lbeg lend)))
+           (cond
+            ((pcase (sweeprolog-op-prefix-precedence sym)
+               ('nil (sweeprolog-indent-line-after-term ppss))
+               (pre  (sweeprolog-indent-line-after-prefix lbeg lend pre)))))))
+        (`(operator ,lbeg ,lend)
+         (let ((op (buffer-substring-no-properties lbeg lend)))
+           (cond
+            ((string= op ".") 'noindent)
+            ((pcase (sweeprolog-op-infix-precedence op)
+               ('nil nil)
+               (1200 (sweeprolog-indent-line-after-neck lbeg lend))
+               (pre  (sweeprolog-indent-line-after-infix lbeg lend pre))))
+            ((pcase (sweeprolog-op-prefix-precedence op)
+               ('nil nil)
+               (pre  (sweeprolog-indent-line-after-prefix lbeg lend pre)))))))
+        (`(,_ltyp ,_lbeg ,_lend)
+         (sweeprolog-indent-line-after-term ppss))))))
+
 (defun sweeprolog-indent-line ()
   "Indent the current line in a Sweep Prolog mode buffer."
   (interactive)
   (let ((pos (- (point-max) (point))))
     (back-to-indentation)
-    (let ((column (if-let ((ppss (syntax-ppss))
-                           (open (nth 8 ppss)))
-                      ;; Inside a comment or a string.
-                      (if (nth 4 ppss)
-                          ;; It's a comment.  Indent like
-                          ;; `indent--default-inside-comment'.
-                          (save-excursion
-                            (forward-line -1)
-                            (skip-chars-forward " \t")
-                            (when (< (1- (point)) open (line-end-position))
-                              (goto-char open)
-                              (when (looking-at comment-start-skip)
-                                (goto-char (match-end 0))))
-                            (current-column))
-                        ;; It's a string.  Don't indent.
-                        'noindent)
-                    (if-let ((open (and (not (eobp))
-                                        (= (sweeprolog-syntax-class-at (point)) 5)
-                                        (nth 1 (syntax-ppss)))))
-                        (save-excursion
-                          (goto-char open)
-                          (when (member (sweeprolog-syntax-class-at (1- (point)))
-                                        '(2 3))
-                            (when (save-excursion
-                                    (forward-char)
-                                    (skip-syntax-forward " " (pos-eol))
-                                    (eolp))
-                              (skip-syntax-backward "w_")))
-                          (current-column))
-                      (pcase (sweeprolog-last-token-boundaries)
-                        ('nil 'noindent)
-                        (`(functor ,lbeg ,lend)
-                         (sweeprolog-indent-line-after-functor lbeg lend))
-                        (`(open ,lbeg ,lend)
-                         (sweeprolog-indent-line-after-open lbeg lend))
-                        (`(symbol ,lbeg ,lend)
-                         (let ((sym (buffer-substring-no-properties lbeg lend)))
-                           (cond
-                            ((pcase (sweeprolog-op-prefix-precedence sym)
-                               ('nil (sweeprolog-indent-line-after-term))
-                               (pre  (sweeprolog-indent-line-after-prefix lbeg lend pre)))))))
-                        (`(operator ,lbeg ,lend)
-                         (let ((op (buffer-substring-no-properties lbeg lend)))
-                           (cond
-                            ((string= op ".") 'noindent)
-                            ((pcase (sweeprolog-op-infix-precedence op)
-                               ('nil nil)
-                               (1200 (sweeprolog-indent-line-after-neck lbeg lend))
-                               (pre  (sweeprolog-indent-line-after-infix lbeg lend pre))))
-                            ((pcase (sweeprolog-op-prefix-precedence op)
-                               ('nil nil)
-                               (pre  (sweeprolog-indent-line-after-prefix lbeg lend pre)))))))
-                        (`(,_ltyp ,_lbeg ,_lend)
-                         (sweeprolog-indent-line-after-term)))))))
+    (let ((column (sweeprolog--indent-column (syntax-ppss))))
       (when (numberp column)
         (unless (= column (current-column))
           (combine-after-change-calls
@@ -5369,6 +5790,50 @@ accordingly."
         (goto-char (- (point-max) pos)))
       column)))
 
+(defun sweeprolog-indent-region (start end)
+  "Indent the lines between START and END in a Sweep Prolog mode buffer.
+
+This is the `indent-region-function' for `sweeprolog-mode'.  It
+gives the same results as calling `sweeprolog-indent-line' on
+each non-empty line in the region, but it makes a single pass
+over the region, carrying the syntax state and the last token
+from line to line, and it runs `after-change-functions' once for
+the entire region instead of once for every line it reindents."
+  (save-excursion
+    (goto-char start)
+    (setq start (pos-bol))
+    (syntax-propertize end)
+    (combine-change-calls start end
+      (let ((end (copy-marker end))
+            (ppss (syntax-ppss start))
+            (token (sweeprolog-last-token-boundaries start))
+            (last start)
+            (progress (make-progress-reporter "Indenting region..."
+                                              start end)))
+        (goto-char start)
+        (while (< (point) end)
+          (unless (and (bolp) (eolp))
+            (back-to-indentation)
+            (setq ppss (parse-partial-sexp last (point) nil nil ppss))
+            (let ((column (sweeprolog--indent-column ppss token)))
+              (when (and (numberp column)
+                         (/= column (current-column)))
+                (delete-horizontal-space)
+                (indent-to column)))
+            ;; Reindenting only changed whitespace before point, so
+            ;; PPSS is still the syntax state at point.
+            (setq last (point))
+            ;; Only whitespace separates the end of this line from
+            ;; the indentation of the next non-empty line, so the last
+            ;; token before the latter is the last token before the
+            ;; former.  Scanning for it from here stops at the last
+            ;; token of this line, if there is one.
+            (setq token (sweeprolog--scan-last-token (pos-eol))))
+          (forward-line 1)
+          (progress-reporter-update progress (point)))
+        (set-marker end nil)
+        (progress-reporter-done progress)))))
+
 
 ;;;; Xref
 
@@ -5418,6 +5883,39 @@ accordingly."
                             (xref-make-file-location path line 0))))
              matches)))
 
+;;;###autoload
+(defun sweeprolog-find-functor-occurrences (functor arity &optional project)
+  "Find terms with functor FUNCTOR and arity ARITY in PROJECT.
+
+This command lists all terms with the given functor in the Prolog
+files of PROJECT, including data terms as well as goals and
+clause heads, using an index of functor occurrences that Sweep
+maintains for each file.  If PROJECT is nil, it defaults to the
+current project.
+
+Interactively, prompt for FUNCTOR and ARITY."
+  (interactive (let ((functor-arity (sweeprolog-read-functor)))
+                 (list (car functor-arity) (cdr functor-arity))))
+  (let* ((proj (or project (project-current) (user-error "No current project")))
+         (files (seq-filter (lambda (path)
+                              (string= "pl" (file-name-extension path)))
+                            (project-files proj))))
+    (save-some-buffers nil (lambda ()
+                             (member buffer-file-name files)))
+    (let* ((locs (sweeprolog--query-once "sweep" "sweep_functor_occurrences"
+                                         (list functor arity files)))
+           (items
+            (mapcar
+             (pcase-lambda (`(,file ,line ,column ,text))
+               (xref-make text (xref-make-file-location file line column)))
+             locs))
+           (fetcher (lambda () items)))
+      (unless items
+        (user-error "No occurrences of %s/%d found" functor arity))
+      (if (fboundp 'xref-show-xrefs)
+          (xref-show-xrefs fetcher nil)
+        (xref--show-xrefs fetcher nil)))))
+
 
 ;;;; Imenu
 
@@ -5434,25 +5932,45 @@ accordingly."
 
 ;;;; ElDoc
 
+(defvar-local sweeprolog--eldoc-top-term nil
+  "Cached top term for ElDoc, a list (TICK BEG END STRING).")
+
+(defun sweeprolog--eldoc-top-term ()
+  "Return a list (BEG END STRING) describing the top term at point.
+
+Reuse the bounds and text of the previous call while the buffer is
+unmodified and point stays inside the same top term."
+  (pcase sweeprolog--eldoc-top-term
+    ((and `(,tick ,beg ,end ,str)
+          (guard (and (= tick (buffer-chars-modified-tick))
+                      (<= beg (point))
+                      (< (point) end))))
+     (list beg end str))
+    (_
+     (let* ((beg (save-excursion
+                   (unless (sweeprolog-at-beginning-of-top-term-p)
+                     (sweeprolog-beginning-of-top-term))
+                   (point)))
+            (end (save-excursion
+                   (sweeprolog-end-of-top-term)
+                   (point)))
+            (str (buffer-substring-no-properties beg end)))
+       (setq sweeprolog--eldoc-top-term
+             (list (buffer-chars-modified-tick) beg end str))
+       (list beg end str)))))
+
 (defun sweeprolog-predicate-modes-doc (cb)
   "Call CB with the documentation of the predicate at point, if any."
-  (when-let ((clause-beg (save-excursion
-                           (unless (sweeprolog-at-beginning-of-top-term-p)
-                             (sweeprolog-beginning-of-top-term))
-                           (point)))
-             (clause-end (save-excursion
-                           (sweeprolog-end-of-top-term)
-                           (point)))
-             (clause-str (buffer-substring-no-properties clause-beg
-                                                         clause-end)))
-    (pcase (sweeprolog--query-once
-            "sweep" "sweep_short_documentation"
-            (list clause-str (- (point) clause-beg) buffer-file-name))
-      (`(,pi ,doc ,span)
-       (when span
-         (add-face-text-property (car span) (cdr span)
-                                 'sweeprolog-eldoc-argument-highlight nil doc))
-       (funcall cb doc :thing pi :face 'sweeprolog-predicate-indicator)))))
+  (pcase (sweeprolog--eldoc-top-term)
+    (`(,clause-beg ,_ ,clause-str)
+     (pcase (sweeprolog--query-once
+             "sweep" "sweep_short_documentation"
+             (list clause-str (- (point) clause-beg) buffer-file-name))
+       (`(,pi ,doc ,span)
+        (when span
+          (add-face-text-property (car span) (cdr span)
+                                  'sweeprolog-eldoc-argument-highlight nil doc))
+        (funcall cb doc :thing pi :face 'sweeprolog-predicate-indicator))))))
 
 ;;;; Top-level Menu
 
@@ -5606,7 +6124,26 @@ accordingly."
                                  #'sweeprolog-describe-predicate
                                  pred))))))))))
 
+(defvar sweeprolog--html-render-cache (make-hash-table :test #'equal)
+  "Hash table of rendered documentation pages.
+
+Keys are conses (WIDTH . HTML) and values are the result of
+rendering HTML in a window of width WIDTH.")
+
 (defun sweeprolog-render-html (html)
+  "Return the text and properties that rendering HTML with `shr' produces.
+
+Cache the result, so repeated help lookups do not render the same
+page again."
+  (let ((key (cons (window-width) html)))
+    (or (gethash key sweeprolog--html-render-cache)
+        (progn
+          (when (< 256 (hash-table-count sweeprolog--html-render-cache))
+            (clrhash sweeprolog--html-render-cache))
+          (puthash key (sweeprolog--render-html html)
+                   sweeprolog--html-render-cache)))))
+
+(defun sweeprolog--render-html (html)
   (with-temp-buffer
     (insert html)
     (setq sweeprolog--html-footnotes nil)
@@ -5653,6 +6190,27 @@ accordingly."
   (interactive (list (sweeprolog-read-module-name)))
   (sweeprolog--describe-module mod))
 
+;;;###autoload
+(defun sweeprolog-prewarm-documentation (&optional project)
+  "Render documentation for the modules that PROJECT imports.
+
+PROJECT defaults to the current project.  Sweep renders the
+documentation of the modules that the Prolog files of PROJECT
+import, and of the predicates that these modules export, in a
+background thread.  Later invocations of
+`sweeprolog-describe-module' and `sweeprolog-describe-predicate'
+for these modules and predicates then reuse the rendered pages."
+  (interactive)
+  (sweeprolog-ensure-initialized)
+  (let* ((proj (or project (project-current) (user-error "No current project")))
+         (files (seq-filter (lambda (path)
+                              (string= "pl" (file-name-extension path)))
+                            (project-files proj))))
+    (sweeprolog--query-once "sweep" "sweep_html_documentation_prewarm" files)
+    (when (called-interactively-p 'interactive)
+      (message "Rendering documentation for %d files in the background."
+               (length files)))))
+
 (defun sweeprolog--render-predicate-properties (props)
   (concat
    "\n\nPredicate properties: "
@@ -5834,6 +6392,7 @@ accordingly."
           (dolist (autoloaded missing)
             (let* ((file    (nth 0 autoloaded))
                    (pred    (nth 1 autoloaded))
+                   (spec    (nth 3 autoloaded))
                    (kind    (pcase sweeprolog-dependency-directive
                               ('use-module "use_module")
                               ('infer (if (equal styles '(use-module))
@@ -5845,9 +6404,7 @@ accordingly."
                     (goto-char last-directive-end)
                     (insert-before-markers
                      ":- " kind "("
-                     (sweeprolog--query-once "sweep"
-                                             "sweep_file_path_in_library"
-                                             file)
+                     spec
                      ").\n")
                     (indent-region-line-by-line (save-excursion
                                                   (sweeprolog-beginning-of-top-term)
@@ -5891,9 +6448,7 @@ accordingly."
                     (goto-char last-directive-end)
                     (insert-before-markers
                      ":- " kind "("
-                     (sweeprolog--query-once "sweep"
-                                             "sweep_file_path_in_library"
-                                             file)
+                     spec
                      ", [" pred "]).\n")
                     (indent-region-line-by-line (save-excursion
                                                   (sweeprolog-beginning-of-top-term)
@@ -5903,6 +6458,83 @@ accordingly."
           (sweeprolog-analyze-buffer t))
       (message "No implicit autoloads found."))))
 
+(defun sweeprolog-unused-dependencies (&optional buffer)
+  "Return the files that BUFFER depends on without using them.
+
+These are the files from which BUFFER calls no predicates, except
+for files that export operators or define term or goal expansion
+hooks, since those can affect BUFFER without being called.  Files
+that BUFFER loads only for other side effects still count as
+unused.
+
+BUFFER defaults to the current buffer."
+  (sweeprolog--query-once "sweep" "sweep_unused_dependencies"
+                          (buffer-file-name buffer)))
+
+(defun sweeprolog-show-unused-dependencies ()
+  "Display the dependencies of the current buffer that it does not use."
+  (interactive "" sweeprolog-mode)
+  (if-let ((unused (sweeprolog-unused-dependencies)))
+      (message "Unused dependencies: %s" (string-join unused ", "))
+    (message "No unused dependencies found.")))
+
+(defun sweeprolog--read-dependency-project ()
+  "Return the project for a dependency graph command.
+
+With a prefix argument, prompt for the project directory."
+  (or (and current-prefix-arg
+           (fboundp 'project-prompt-project-dir)
+           (let ((default-directory (project-prompt-project-dir)))
+             (project-current)))
+      (project-current)
+      (user-error "No current project")))
+
+(defun sweeprolog-dependency-graph-root (project)
+  "Cross reference the Prolog files in PROJECT and return its root."
+  (sweeprolog-xref-project-source-files project)
+  (expand-file-name (project-root project)))
+
+(defun sweeprolog-dependency-cycles (project)
+  "Display cyclic dependencies between Prolog files in PROJECT.
+
+Interactively, PROJECT is the current project, or with a prefix
+argument, a project that you select."
+  (interactive (list (sweeprolog--read-dependency-project)))
+  (let* ((root (sweeprolog-dependency-graph-root project))
+         (cycles (sweeprolog--query-once "sweep" "sweep_dependency_cycles"
+                                         root)))
+    (if (null cycles)
+        (message "No dependency cycles found.")
+      (with-current-buffer (get-buffer-create "*Sweep Dependency Cycles*")
+        (let ((inhibit-read-only t))
+          (erase-buffer)
+          (dolist (cycle cycles)
+            (insert "Files that depend on each other:\n")
+            (dolist (file cycle)
+              (insert "  " (file-relative-name file root) "\n"))
+            (insert "\n")))
+        (special-mode)
+        (setq default-directory root)
+        (display-buffer (current-buffer))))))
+
+(defun sweeprolog-export-dependency-graph (file project)
+  "Write the dependency graph of Prolog files in PROJECT to FILE.
+
+FILE is written in Graphviz DOT format.  Interactively, prompt for
+FILE, and PROJECT is the current project, or with a prefix
+argument, a project that you select."
+  (interactive
+   (let ((project (sweeprolog--read-dependency-project)))
+     (list (read-file-name "Export dependency graph to: "
+                           nil nil nil "dependencies.dot")
+           project)))
+  (let ((dot (sweeprolog--query-once "sweep" "sweep_dependency_graph_dot"
+                                     (sweeprolog-dependency-graph-root
+                                      project))))
+    (with-temp-file file
+      (insert dot))
+    (message "Wrote dependency graph to %s" file)))
+
 
 ;;;; Minor mode for moving to the next hole with TAB
 
@@ -6055,23 +6687,25 @@ minibuffer."
                           (when (derived-mode-p 'sweeprolog-mode)
                             (sweeprolog-goals-at-point)))))
 
+(defun sweeprolog--term-replace-state (classes)
+  (mapcar (lambda (class)
+            (pcase class
+              ('goal "goal(_)")
+              (_ (symbol-name class))))
+          classes))
+
 (defun sweeprolog-term-replace-edits (file template replacement condition classes)
-  (let ((state (mapcar (lambda (class)
-                         (pcase class
-                           ('goal "goal(_)")
-                           (_ (symbol-name class))))
-                       classes)))
-    (mapcar
-     (pcase-lambda (`(compound "replace" ,beg ,end ,rep))
-       (list (1+ beg) (1+ end) rep))
-     (without-restriction
-       (sweeprolog--query-once "sweep" "sweep_term_replace"
-                               (list file
-                                     sweeprolog-indent-offset
-                                     template
-                                     condition
-                                     state
-                                     replacement))))))
+  (mapcar
+   (pcase-lambda (`(compound "replace" ,beg ,end ,rep))
+     (list (1+ beg) (1+ end) rep))
+   (without-restriction
+     (sweeprolog--query-once "sweep" "sweep_term_replace"
+                             (list file
+                                   sweeprolog-indent-offset
+                                   template
+                                   condition
+                                   (sweeprolog--term-replace-state classes)
+                                   replacement)))))
 
 ;;;###autoload
 (defun sweeprolog-term-search (template &optional backward condition class)
@@ -6179,7 +6813,7 @@ prompt for CLASS as well.  A negative prefix argument
                                       length)
                               '((?  "next" "Next match")
                                 (?  "back" "Last match")
-                                (?  "exit" "Exit term search"))))
+                                (?\C-m "exit" "Exit term search"))))
                       (?
                        (setq overlays (if backward
                                           (cons overlay
@@ -6200,7 +6834,7 @@ prompt for CLASS as well.  A negative prefix argument
                                        (mod (1- index) length)
                                      index)
                              backward t))
-                      (?
+                      (?\C-m
                        (setq go nil)
                        t))
                     (overlay-put overlay 'priority nil)
@@ -6393,6 +7027,138 @@ prompt for CLASS as well."
                        " of %s.")
                count template))))
 
+(defvar-local sweeprolog-project-replace-job nil
+  "Project replacement job of the current buffer.
+
+This is a list (ID TEMPLATE REPLACEMENT CONDITION CLASS), where ID
+identifies the job in Prolog and the rest are the arguments of
+`sweeprolog-project-replace-term'.")
+
+(defun sweeprolog-project-replace-done ()
+  "Release the Prolog data of the project replacement job in this buffer."
+  (when sweeprolog-project-replace-job
+    (condition-case _
+        (sweeprolog--query-once "sweep" "sweep_project_replace_done"
+                                (car sweeprolog-project-replace-job))
+      (prolog-exception nil))))
+
+(defun sweeprolog-project-replace-apply ()
+  "Replace all matches of the project replacement job in this buffer.
+
+This command computes the replacements of each file with matches
+again, so it takes into account changes you made since the search,
+and applies them to the buffer visiting the file as a single
+change.  It does not save the modified buffers."
+  (interactive "" sweeprolog-project-replace-mode)
+  (pcase-let* ((`(,id ,template ,replacement ,condition ,class)
+                sweeprolog-project-replace-job)
+               (files (sweeprolog--query-once "sweep" "sweep_project_replace_files" id))
+               (count 0)
+               (changed 0))
+    (dolist-with-progress-reporter (file files)
+        "Replacing terms in project files... "
+      (with-current-buffer (find-file-noselect file)
+        (let ((edits (sort (sweeprolog-term-replace-edits file template
+                                                          replacement
+                                                          condition class)
+                           (lambda (a b) (> (car a) (car b)))))
+              (limit nil))
+          (when edits
+            (undo-boundary)
+            (save-excursion
+              (save-restriction
+                (widen)
+                (combine-change-calls (point-min) (point-max)
+                  (pcase-dolist (`(,beg ,end ,rep) edits)
+                    (unless (and limit (< limit end))
+                      (goto-char beg)
+                      (delete-region beg end)
+                      (insert rep)
+                      (let ((inhibit-message t))
+                        (indent-region beg (point)))
+                      (setq limit beg)
+                      (cl-incf count))))))
+            (cl-incf changed)))))
+    (message (concat "Replaced %d "
+                     (ngettext "occurrence" "occurrences" count)
+                     " of %s in %d "
+                     (ngettext "file" "files" changed)
+                     ".")
+             count template changed)))
+
+(defvar sweeprolog-project-replace-mode-map
+  (let ((map (make-sparse-keymap)))
+    (set-keymap-parent map sweeprolog-async-goal-output-mode-map)
+    (define-key map (kbd "!") #'sweeprolog-project-replace-apply)
+    map)
+  "Keymap used by `sweeprolog-project-replace-mode'.")
+
+(define-derived-mode sweeprolog-project-replace-mode
+  sweeprolog-async-goal-output-mode "Sweep Replace"
+  "Major mode for browsing the matches of project-wide term replacement.
+
+Type \\<sweeprolog-project-replace-mode-map>\\[sweeprolog-project-replace-apply]
+to apply all replacements."
+  (add-hook 'kill-buffer-hook #'sweeprolog-project-replace-done nil t))
+
+;;;###autoload
+(defun sweeprolog-project-replace-term (template replacement &optional condition class project)
+  "Replace terms matching TEMPLATE with REPLACEMENT in all of PROJECT.
+
+This command searches all Prolog files in PROJECT for terms
+matching TEMPLATE, on a pool of Prolog threads, and lists the
+matches in a new buffer as they are found.  In that buffer, type
+\\<sweeprolog-project-replace-mode-map>\\[sweeprolog-project-replace-apply]
+to apply all replacements.  TEMPLATE, REPLACEMENT, CONDITION and
+CLASS have the same meaning as in `sweeprolog-query-replace-term'.
+If PROJECT is nil, it defaults to the current project.
+
+The search reads files from disk, so this command first offers to
+save modified buffers that visit files in PROJECT."
+  (interactive (let* ((template (sweeprolog-read-term "[Project replace] ?- "))
+                      (replacement
+                       (sweeprolog-read-term
+                        (concat "[Replace " template " with] ?- ")))
+                      (condition (when current-prefix-arg
+                                   (sweeprolog-read-goal
+                                    (concat "[Condition for replacing "
+                                            template
+                                            "] ?- "))))
+                      (class (when (equal current-prefix-arg '(16))
+                               (mapcar #'intern
+                                       (completing-read-multiple
+                                        (format-prompt "Replace terms of class" "_")
+                                        '("clause" "head" "goal" "data" "_")
+                                        nil t nil nil "_")))))
+                 (list template replacement condition class)))
+  (setq condition (or condition           "true")
+        class     (or (ensure-list class) '(_))
+        project   (or project (project-current) (user-error "No current project")))
+  (let ((files (seq-filter (lambda (path)
+                             (string= "pl" (file-name-extension path)))
+                           (project-files project))))
+    (save-some-buffers nil (lambda ()
+                             (member buffer-file-name files)))
+    (let* ((id (sweeprolog--query-once "sweep" "sweep_project_replace_start"
+                                       (list files
+                                             sweeprolog-indent-offset
+                                             template
+                                             condition
+                                             (sweeprolog--term-replace-state class)
+                                             replacement)))
+           (goal (format "sweep:sweep_project_replace_run(%d)" id))
+           (buffer (get-buffer-create
+                    (generate-new-buffer-name
+                     (format "*Sweep Replace %s*" template))))
+           (job (sweeprolog-async-goal-start goal buffer)))
+      (with-current-buffer buffer
+        (sweeprolog-project-replace-mode)
+        (setq sweeprolog-async-goal-job-id     job
+              sweeprolog-async-goal-current-goal goal
+              sweeprolog-project-replace-job
+              (list id template replacement condition class)))
+      (display-buffer buffer))))
+
 
 ;;;; Right-Click Context Menu
 
@@ -6676,17 +7442,20 @@ the position for which the menu is created.")
 
 ;;;; Async Prolog Queries
 
-(defvar-local sweeprolog-async-goal-thread-id nil
-  "Prolog thread running the async goal of the current buffer.")
+(defvar-local sweeprolog-async-goal-job-id nil
+  "Prolog job of the async goal of the current buffer.")
 
 (defvar-local sweeprolog-async-goal-current-goal nil
   "Prolog async goal of the current buffer.")
 
+(defvar-local sweeprolog-async-goal-priority nil
+  "Scheduling priority of the async goal of the current buffer, if any.")
+
 (defun sweeprolog-async-goal-interrupt (proc &optional _group)
   "Interrupt async Prolog goal associated with process PROC."
   (with-current-buffer (process-buffer proc)
     (sweeprolog--query-once "sweep" "sweep_interrupt_async_goal"
-                            sweeprolog-async-goal-thread-id)))
+                            sweeprolog-async-goal-job-id)))
 
 (defun sweeprolog-async-goal-filter (proc string)
   "Process filter function for async Prolog queries.
@@ -6698,8 +7467,14 @@ Deletes PROC if STRING contains an end of output marker string."
     (sit-for 1)
     (delete-process proc)))
 
-(defun sweeprolog-async-goal-start (goal &optional buffer)
-  "Start async Prolog goal GOAL and direct its output to BUFFER."
+(defun sweeprolog-async-goal-start (goal &optional buffer priority)
+  "Start async Prolog goal GOAL and direct its output to BUFFER.
+
+If PRIORITY is non-nil, schedule GOAL to run when a thread of the
+async goal pool is free, before waiting goals with lower
+priorities.  Otherwise, start GOAL right away.
+
+Return the Prolog job identifier of GOAL."
   (setq buffer (or buffer (current-buffer)))
   (sweeprolog-ensure-initialized)
   (if (fboundp 'sweeprolog-open-channel)
@@ -6708,8 +7483,11 @@ Deletes PROC if STRING contains an end of output marker string."
                     :buffer buffer
                     :filter #'sweeprolog-async-goal-filter))
              (fd (sweeprolog-open-channel proc)))
-        (sweeprolog--query-once "sweep" "sweep_async_goal"
-                                (cons goal fd)))
+        (if priority
+            (sweeprolog--query-once "sweep" "sweep_async_schedule"
+                                    (cons goal (cons priority fd)))
+          (sweeprolog--query-once "sweep" "sweep_async_goal"
+                                  (cons goal fd))))
     (error "Async queries require Emacs 28 and SWI-Prolog 9.1.4 or later")))
 
 (defun sweeprolog-async-goal-restart ()
@@ -6726,9 +7504,10 @@ Deletes PROC if STRING contains an end of output marker string."
               (error nil))
           (error "Cannot have two processes in `%s' at once"
                  (buffer-name)))))
-  (setq sweeprolog-async-goal-thread-id
+  (setq sweeprolog-async-goal-job-id
         (sweeprolog-async-goal-start
-         sweeprolog-async-goal-current-goal)))
+         sweeprolog-async-goal-current-goal
+         nil sweeprolog-async-goal-priority)))
 
 (defvar sweeprolog-async-goal-output-mode-map
   (let ((map (make-sparse-keymap)))
@@ -6746,10 +7525,10 @@ Deletes PROC if STRING contains an end of output marker string."
             (lambda ()
               (when-let ((proc (get-buffer-process (current-buffer))))
                 (when (and (process-live-p proc)
-                           sweeprolog-async-goal-thread-id)
+                           sweeprolog-async-goal-job-id)
                   (condition-case _
                       (sweeprolog--query-once "sweep" "sweep_interrupt_async_goal"
-                                              sweeprolog-async-goal-thread-id)
+                                              sweeprolog-async-goal-job-id)
                     (prolog-exception nil)))))
             nil t))
 
@@ -6760,13 +7539,155 @@ Deletes PROC if STRING contains an end of output marker string."
   (let* ((buffer-name (generate-new-buffer-name
                        (format "*Async Output for %s*" goal)))
          (buffer (get-buffer-create buffer-name))
-         (tid (sweeprolog-async-goal-start goal buffer)))
+         (job (sweeprolog-async-goal-start goal buffer)))
     (with-current-buffer buffer
       (sweeprolog-async-goal-output-mode)
-      (setq sweeprolog-async-goal-thread-id     tid
+      (setq sweeprolog-async-goal-job-id     job
             sweeprolog-async-goal-current-goal goal))
     (display-buffer buffer)))
 
+;;;###autoload
+(defun sweeprolog-schedule-async-goal (goal &optional priority)
+  "Schedule GOAL to run asynchronously with priority PRIORITY.
+
+Unlike `sweeprolog-async-goal', which starts its goal right away,
+this command queues GOAL until a thread of the async goal pool is
+free, so no more scheduled goals run at once than
+`sweeprolog-async-goal-workers' allows.  Goals with higher PRIORITY
+start first.  PRIORITY defaults to 0, and interactively it is the
+numeric prefix argument.
+
+This command collects the output of GOAL in a buffer without
+displaying it.  Use \\[sweeprolog-async-jobs] to list scheduled
+goals and their status.  Return the Prolog job identifier of GOAL."
+  (interactive (list (sweeprolog-read-goal "[schedule] ?- ")
+                     (prefix-numeric-value current-prefix-arg)))
+  (setq priority (or priority 0))
+  (let* ((buffer (get-buffer-create
+                  (generate-new-buffer-name
+                   (format "*Async Output for %s*" goal))))
+         (job (sweeprolog-async-goal-start goal buffer priority)))
+    (with-current-buffer buffer
+      (sweeprolog-async-goal-output-mode)
+      (setq sweeprolog-async-goal-job-id       job
+            sweeprolog-async-goal-current-goal goal
+            sweeprolog-async-goal-priority     priority))
+    (when (called-interactively-p 'interactive)
+      (message "Scheduled job %d" job))
+    job))
+
+(defun sweeprolog-async-jobs--buffer (job)
+  "Return the output buffer of async job JOB, or nil."
+  (seq-find (lambda (buffer)
+              (and (provided-mode-derived-p
+                    (buffer-local-value 'major-mode buffer)
+                    'sweeprolog-async-goal-output-mode)
+                   (equal (buffer-local-value 'sweeprolog-async-goal-job-id
+                                              buffer)
+                          job)))
+            (buffer-list)))
+
+(defun sweeprolog-async-jobs--format-seconds (seconds)
+  (if (numberp seconds)
+      (format "%.3f" seconds)
+    ""))
+
+(defun sweeprolog-async-jobs-mode--entries ()
+  (mapcar (pcase-lambda (`(,id ,goal ,priority ,status ,wall ,cpu ,stack))
+            (list id
+                  (vector (number-to-string id)
+                          status
+                          (number-to-string priority)
+                          (sweeprolog-async-jobs--format-seconds wall)
+                          (sweeprolog-async-jobs--format-seconds cpu)
+                          (sweeprolog-memory-report--format-bytes stack)
+                          goal)))
+          (sweeprolog--query-once "sweep" "sweep_async_jobs" nil)))
+
+(defun sweeprolog-async-jobs-mode--refresh ()
+  (tabulated-list-init-header)
+  (setq tabulated-list-entries (sweeprolog-async-jobs-mode--entries)))
+
+(defun sweeprolog-async-jobs--sort-by-id (a b)
+  "Compare the async job entries A and B by their job identifier."
+  (< (car a) (car b)))
+
+(defun sweeprolog-async-jobs--sort-by-stack (a b)
+  "Compare the async job entries A and B by their stack usage."
+  (< (or (get-text-property 0 'sweeprolog-memory-bytes (aref (cadr a) 5)) 0)
+     (or (get-text-property 0 'sweeprolog-memory-bytes (aref (cadr b) 5)) 0)))
+
+(defun sweeprolog-async-jobs-cancel ()
+  "Cancel the async job at point."
+  (interactive "" sweeprolog-async-jobs-mode)
+  (if-let ((job (tabulated-list-get-id)))
+      (progn
+        (sweeprolog--query-once "sweep" "sweep_interrupt_async_goal" job)
+        (tabulated-list-revert))
+    (user-error "No job at point")))
+
+(defun sweeprolog-async-jobs-display ()
+  "Display the output buffer of the async job at point."
+  (interactive "" sweeprolog-async-jobs-mode)
+  (if-let ((job (tabulated-list-get-id)))
+      (if-let ((buffer (sweeprolog-async-jobs--buffer job)))
+          (display-buffer buffer)
+        (user-error "Output buffer of job %d is gone" job))
+    (user-error "No job at point")))
+
+(defun sweeprolog-async-jobs-clear ()
+  "Forget about finished async jobs."
+  (interactive "" sweeprolog-async-jobs-mode)
+  (sweeprolog--query-once "sweep" "sweep_async_jobs_clear" nil)
+  (tabulated-list-revert))
+
+(defvar sweeprolog-async-jobs-mode-map
+  (let ((map (make-sparse-keymap)))
+    (define-key map (kbd "k") #'sweeprolog-async-jobs-cancel)
+    (define-key map (kbd "RET") #'sweeprolog-async-jobs-display)
+    (define-key map (kbd "c") #'sweeprolog-async-jobs-clear)
+    map)
+  "Local keymap for `sweeprolog-async-jobs-mode' buffers.")
+
+(define-derived-mode sweeprolog-async-jobs-mode
+  tabulated-list-mode "Sweep Jobs"
+  "Major mode for browsing async Prolog jobs.
+
+\\{sweeprolog-async-jobs-mode-map}"
+  (setq tabulated-list-format
+        [("Job"      6  sweeprolog-async-jobs--sort-by-id :right-align t)
+         ("Status"   11 t)
+         ("Priority" 8  nil :right-align t)
+         ("Wall"     10 nil :right-align t)
+         ("CPU"      10 nil :right-align t)
+         ("Stack"    10 sweeprolog-async-jobs--sort-by-stack :right-align t)
+         ("Goal"     0  t)])
+  (setq tabulated-list-padding 2
+        tabulated-list-sort-key '("Job" . t))
+  (add-hook 'tabulated-list-revert-hook
+            #'sweeprolog-async-jobs-mode--refresh nil t)
+  (tabulated-list-init-header))
+
+;;;###autoload
+(defun sweeprolog-async-jobs ()
+  "Display a list of async Prolog jobs.
+
+The list includes the waiting, running and recently finished goals
+of `sweeprolog-async-goal' and `sweeprolog-schedule-async-goal', with
+their status, the wall clock and CPU time they took and the stack
+usage of their threads.\\<sweeprolog-async-jobs-mode-map>  In the list,
+type \\[sweeprolog-async-jobs-cancel] to cancel the job at point,
+\\[sweeprolog-async-jobs-display] to display its output and
+\\[sweeprolog-async-jobs-clear] to forget finished jobs."
+  (interactive)
+  (sweeprolog-ensure-initialized)
+  (let ((buf (get-buffer-create "*Sweep Jobs*")))
+    (with-current-buffer buf
+      (sweeprolog-async-jobs-mode)
+      (sweeprolog-async-jobs-mode--refresh)
+      (tabulated-list-print))
+    (pop-to-buffer buf)))
+
 
 ;;;; Refactoring
 
@@ -7187,12 +8108,12 @@ prompt with \"Breakpoint: \"."
                                           (cdr range))))))
 
 (defun sweeprolog-breakpoints-at-point (file point)
-  (seq-filter (lambda (bp)
-                (and (string= (expand-file-name (alist-get "file" bp nil nil #'string=))
-                              file)
-                     (when-let ((range (alist-get "range" bp nil nil #'string=)))
-                       (<= (car range) point (cadr range)))))
-              (sweeprolog-current-breakpoints)))
+  "Return the list of breakpoints in FILE whose range includes POINT.
+Each breakpoint is represented as an alist with string keys, like
+the elements of the list that `sweeprolog-current-breakpoints'
+returns."
+  (sweeprolog--query-once "sweep" "sweep_breakpoints_at_point"
+                          (list (expand-file-name file) point)))
 
 (defun sweeprolog-read-breakpoint-at-point (point &optional prompt)
   "Prompt with PROMPT for a breakpoint at POINT, with completion.
@@ -7569,6 +8490,467 @@ where in the buffer to insert the newly created predicate."
      arg)
     t))
 
+;;;; Performance Diagnostics
+
+;;;###autoload
+(define-minor-mode sweeprolog-profile-mode
+  "Toggle profiling of the Prolog queries that Sweep performs.
+
+When this global minor mode is enabled, Sweep records the number
+of calls, the total and maximal wall time, the number of string
+bytes converted in each direction and the number of callbacks to
+Elisp for each Prolog predicate that Emacs queries.  Use
+\\[sweeprolog-profile-report] to display the collected statistics."
+  :global t
+  :group 'sweeprolog
+  :package-version '((sweeprolog "0.28.0"))
+  (sweeprolog-ensure-initialized)
+  (sweeprolog-profile-enable sweeprolog-profile-mode))
+
+(defun sweeprolog-profile-report--sort-by (column)
+  "Return a predicate that sorts profile entries numerically by COLUMN."
+  (lambda (a b)
+    (< (string-to-number (aref (cadr a) column))
+       (string-to-number (aref (cadr b) column)))))
+
+(defun sweeprolog-profile-report-mode--entries ()
+  (mapcar (lambda (entry)
+            (pcase entry
+              (`(,name ,calls ,total ,max ,in ,out ,funcalls)
+               (list name
+                     (vector (propertize name
+                                         'face
+                                         'sweeprolog-predicate-indicator)
+                             (number-to-string calls)
+                             (format "%.6f" total)
+                             (format "%.6f" (/ total (max calls 1)))
+                             (format "%.6f" max)
+                             (number-to-string in)
+                             (number-to-string out)
+                             (number-to-string funcalls))))))
+          (sweeprolog-profile-data)))
+
+(defun sweeprolog-profile-report-mode--refresh ()
+  (tabulated-list-init-header)
+  (setq tabulated-list-entries (sweeprolog-profile-report-mode--entries)))
+
+(defun sweeprolog-profile-report-reset ()
+  "Discard all Prolog query statistics collected so far."
+  (interactive "" sweeprolog-profile-report-mode)
+  (sweeprolog-profile-data t)
+  (when (derived-mode-p 'sweeprolog-profile-report-mode)
+    (tabulated-list-revert)))
+
+(defvar sweeprolog-profile-report-mode-map
+  (let ((map (make-sparse-keymap)))
+    (define-key map (kbd "r") #'sweeprolog-profile-report-reset)
+    map)
+  "Local keymap for `sweeprolog-profile-report-mode' buffers.")
+
+(define-derived-mode sweeprolog-profile-report-mode
+  tabulated-list-mode "Sweep Profile"
+  "Major mode for browsing statistics about Sweep's Prolog queries.
+
+See also `sweeprolog-profile-mode'."
+  (setq tabulated-list-format
+        `[("Predicate" 40 t)
+          ("Calls"     8  ,(sweeprolog-profile-report--sort-by 1))
+          ("Total"     12 ,(sweeprolog-profile-report--sort-by 2))
+          ("Mean"      12 ,(sweeprolog-profile-report--sort-by 3))
+          ("Max"       12 ,(sweeprolog-profile-report--sort-by 4))
+          ("Bytes In"  10 ,(sweeprolog-profile-report--sort-by 5))
+          ("Bytes Out" 10 ,(sweeprolog-profile-report--sort-by 6))
+          ("Callbacks" 10 ,(sweeprolog-profile-report--sort-by 7))])
+  (setq tabulated-list-padding 2)
+  (setq tabulated-list-sort-key (cons "Total" t))
+  (add-hook 'tabulated-list-revert-hook
+            #'sweeprolog-profile-report-mode--refresh nil t)
+  (tabulated-list-init-header))
+
+;;;###autoload
+(defun sweeprolog-profile-report ()
+  "Display statistics about the Prolog queries that Sweep performed.
+
+Statistics are only collected while `sweeprolog-profile-mode' is
+enabled.\\<sweeprolog-profile-report-mode-map>  In the report buffer, type \\[revert-buffer] to
+update the displayed statistics and \\[sweeprolog-profile-report-reset] to reset them."
+  (interactive)
+  (sweeprolog-ensure-initialized)
+  (unless sweeprolog-profile-mode
+    (message (substitute-command-keys
+              "Profiling is disabled, use \\[sweeprolog-profile-mode] to enable it")))
+  (let ((buf (get-buffer-create "*Sweep Profile*")))
+    (with-current-buffer buf
+      (sweeprolog-profile-report-mode)
+      (sweeprolog-profile-report-mode--refresh)
+      (tabulated-list-print))
+    (pop-to-buffer buf)))
+
+;;;###autoload
+(define-minor-mode sweeprolog-callback-trace-mode
+  "Toggle tracing of the calls from Prolog to Elisp.
+
+When this global minor mode is enabled, Sweep records each call
+that Prolog makes to an Elisp function via `sweep_funcall/2,3',
+distinguishing the time spent in Elisp from the time spent
+converting the argument and the result between Prolog terms and
+Elisp objects.  Use \\[sweeprolog-callback-trace-report] to
+display the collected statistics, and
+\\[sweeprolog-callback-trace-write] to export the most recent
+calls in Chrome trace event format."
+  :global t
+  :group 'sweeprolog
+  :package-version '((sweeprolog "0.28.0"))
+  (sweeprolog-ensure-initialized)
+  (sweeprolog-callback-trace-enable sweeprolog-callback-trace-mode))
+
+(defun sweeprolog-callback-trace-report-mode--entries ()
+  (mapcar (lambda (entry)
+            (pcase entry
+              (`(,name ,calls ,elisp ,convert ,bytes ,sizes)
+               (list name
+                     (vector (propertize name 'face 'font-lock-function-name-face)
+                             (number-to-string calls)
+                             (format "%.6f" elisp)
+                             (format "%.6f" convert)
+                             (format "%.6f" (/ (+ elisp convert) (max calls 1)))
+                             (number-to-string bytes)
+                             (mapconcat #'number-to-string sizes " "))))))
+          (sweeprolog-callback-trace-data)))
+
+(defun sweeprolog-callback-trace-report-mode--refresh ()
+  (tabulated-list-init-header)
+  (setq tabulated-list-entries
+        (sweeprolog-callback-trace-report-mode--entries)))
+
+(defun sweeprolog-callback-trace-report-reset ()
+  "Discard all statistics and events collected by callback tracing."
+  (interactive "" sweeprolog-callback-trace-report-mode)
+  (sweeprolog-callback-trace-data t)
+  (when (derived-mode-p 'sweeprolog-callback-trace-report-mode)
+    (tabulated-list-revert)))
+
+(defvar sweeprolog-callback-trace-report-mode-map
+  (let ((map (make-sparse-keymap)))
+    (define-key map (kbd "r") #'sweeprolog-callback-trace-report-reset)
+    (define-key map (kbd "w") #'sweeprolog-callback-trace-write)
+    map)
+  "Local keymap for `sweeprolog-callback-trace-report-mode' buffers.")
+
+(define-derived-mode sweeprolog-callback-trace-report-mode
+  tabulated-list-mode "Sweep Callbacks"
+  "Major mode for browsing statistics about calls from Prolog to Elisp.
+
+The Sizes column shows how many calls converted less than 16, 64,
+256, 1K, 4K, 16K and 64K bytes of strings, and how many converted
+more than that.
+
+See also `sweeprolog-callback-trace-mode'."
+  (setq tabulated-list-format
+        `[("Function" 40 t)
+          ("Calls"    8  ,(sweeprolog-profile-report--sort-by 1))
+          ("Elisp"    12 ,(sweeprolog-profile-report--sort-by 2))
+          ("Convert"  12 ,(sweeprolog-profile-report--sort-by 3))
+          ("Mean"     12 ,(sweeprolog-profile-report--sort-by 4))
+          ("Bytes"    10 ,(sweeprolog-profile-report--sort-by 5))
+          ("Sizes"    0  nil)])
+  (setq tabulated-list-padding 2)
+  (setq tabulated-list-sort-key (cons "Elisp" t))
+  (add-hook 'tabulated-list-revert-hook
+            #'sweeprolog-callback-trace-report-mode--refresh nil t)
+  (tabulated-list-init-header))
+
+;;;###autoload
+(defun sweeprolog-callback-trace-report ()
+  "Display statistics about the calls from Prolog to Elisp.
+
+Statistics are only collected while `sweeprolog-callback-trace-mode'
+is enabled.\\<sweeprolog-callback-trace-report-mode-map>  In the
+report buffer, type \\[revert-buffer] to update the displayed
+statistics, \\[sweeprolog-callback-trace-report-reset] to reset
+them and \\[sweeprolog-callback-trace-write] to export the most
+recent calls to a file."
+  (interactive)
+  (sweeprolog-ensure-initialized)
+  (unless sweeprolog-callback-trace-mode
+    (message (substitute-command-keys
+              "Callback tracing is disabled, use \\[sweeprolog-callback-trace-mode] to enable it")))
+  (let ((buf (get-buffer-create "*Sweep Callbacks*")))
+    (with-current-buffer buf
+      (sweeprolog-callback-trace-report-mode)
+      (sweeprolog-callback-trace-report-mode--refresh)
+      (tabulated-list-print))
+    (pop-to-buffer buf)))
+
+(defun sweeprolog-callback-trace--chrome-events ()
+  "Return the recent calls from Prolog to Elisp as Chrome trace events."
+  (mapcar (lambda (event)
+            (pcase event
+              (`(,name ,start ,elisp ,convert ,bytes)
+               `((name . ,name)
+                 (cat  . "sweep_funcall")
+                 (ph   . "X")
+                 (ts   . ,(* start 1e6))
+                 (dur  . ,(* (+ elisp convert) 1e6))
+                 (pid  . ,(emacs-pid))
+                 (tid  . 1)
+                 (args . ((elisp   . ,(* elisp 1e6))
+                          (convert . ,(* convert 1e6))
+                          (bytes   . ,bytes)))))))
+          (sweeprolog-callback-trace-events)))
+
+(defun sweeprolog-callback-trace-write (file)
+  "Write the most recent calls from Prolog to Elisp to FILE.
+
+The calls are written in the JSON trace event format that the
+Chrome and Perfetto trace viewers understand, with times given in
+microseconds.  Only calls made while `sweeprolog-callback-trace-mode'
+was enabled are included."
+  (interactive (list (read-file-name "Write callback trace to file: "
+                                     nil nil nil "sweep-trace.json")))
+  (sweeprolog-ensure-initialized)
+  (require 'json)
+  (let ((events (sweeprolog-callback-trace--chrome-events)))
+    (with-temp-file file
+      (insert (json-encode `((traceEvents . ,(vconcat events))))))
+    (message "Wrote %d callback trace events to %s"
+             (length events) (abbreviate-file-name file))))
+
+(defun sweeprolog-memory-report--format-bytes (bytes)
+  (if (integerp bytes)
+      (propertize (file-size-human-readable bytes)
+                  'sweeprolog-memory-bytes bytes)
+    ""))
+
+(defun sweeprolog-memory-report-mode--entries ()
+  (let ((id 0))
+    (mapcar (lambda (row)
+              (pcase row
+                (`(,category ,name ,count ,bytes)
+                 (list (setq id (1+ id))
+                       (vector category
+                               name
+                               (if (integerp count)
+                                   (number-to-string count)
+                                 "")
+                               (sweeprolog-memory-report--format-bytes bytes))))))
+            (sweeprolog--query-once "sweep" "sweep_memory_report" nil))))
+
+(defun sweeprolog-memory-report-mode--refresh ()
+  (tabulated-list-init-header)
+  (setq tabulated-list-entries (sweeprolog-memory-report-mode--entries)))
+
+(defun sweeprolog-memory-report--sort-by-bytes (a b)
+  "Compare the memory report entries A and B by their size."
+  (< (or (get-text-property 0 'sweeprolog-memory-bytes (aref (cadr a) 3)) 0)
+     (or (get-text-property 0 'sweeprolog-memory-bytes (aref (cadr b) 3)) 0)))
+
+(defun sweeprolog-memory-purge-xref ()
+  "Discard cross reference data for files not visited in Sweep buffers."
+  (interactive)
+  (sweeprolog-ensure-initialized)
+  (let* ((keep (delq nil
+                     (mapcar (lambda (buffer)
+                               (with-current-buffer buffer
+                                 (and (derived-mode-p 'sweeprolog-mode)
+                                      (buffer-file-name))))
+                             (buffer-list))))
+         (count (sweeprolog--query-once "sweep" "sweep_xref_purge" keep)))
+    (message "Discarded cross reference data for %d source files" count)
+    (when (derived-mode-p 'sweeprolog-memory-report-mode)
+      (tabulated-list-revert))))
+
+(defun sweeprolog-memory-collect-garbage ()
+  "Reclaim unused atoms, clauses and stack space in the Prolog runtime."
+  (interactive)
+  (sweeprolog-ensure-initialized)
+  (let ((freed (sweeprolog--query-once "sweep" "sweep_garbage_collect" nil)))
+    (message "Reclaimed %d atoms" freed)
+    (when (derived-mode-p 'sweeprolog-memory-report-mode)
+      (tabulated-list-revert))))
+
+(defvar sweeprolog-memory-report-mode-map
+  (let ((map (make-sparse-keymap)))
+    (define-key map (kbd "x") #'sweeprolog-memory-purge-xref)
+    (define-key map (kbd "c") #'sweeprolog-memory-collect-garbage)
+    map)
+  "Local keymap for `sweeprolog-memory-report-mode' buffers.")
+
+(define-derived-mode sweeprolog-memory-report-mode
+  tabulated-list-mode "Sweep Memory"
+  "Major mode for browsing the memory usage of the Prolog runtime.
+
+\\{sweeprolog-memory-report-mode-map}"
+  (setq tabulated-list-format
+        [("Category" 16 t)
+         ("Item"     48 t)
+         ("Count"    10 nil :right-align t)
+         ("Size"     10 sweeprolog-memory-report--sort-by-bytes :right-align t)])
+  (setq tabulated-list-padding 2)
+  (add-hook 'tabulated-list-revert-hook
+            #'sweeprolog-memory-report-mode--refresh nil t)
+  (tabulated-list-init-header))
+
+;;;###autoload
+(defun sweeprolog-thread-statistics ()
+  "Display the number of Prolog threads that Sweep supervises.
+
+This reports the number of live threads that Sweep started for
+top-levels and async goals, the number of such threads that
+exited, and the number of leaked threads, which stopped without
+notifying Sweep.  Sweep reclaims the resources of leaked threads
+when it finds them.  Return a list (LIVE EXITED LEAKED)."
+  (interactive)
+  (sweeprolog-ensure-initialized)
+  (let ((counts (sweeprolog--query-once "sweep" "sweep_thread_statistics" nil)))
+    (when (called-interactively-p 'interactive)
+      (apply #'message "Sweep threads: %d live, %d exited, %d leaked" counts))
+    counts))
+
+(defun sweeprolog-top-level-benchmark--send (proc input)
+  "Send INPUT to the top-level process PROC and wait for a prompt."
+  (with-current-buffer (process-buffer proc)
+    (let ((start (marker-position (process-mark proc))))
+      (comint-send-string proc input)
+      (while (not (and comint-last-prompt
+                       (< start (car comint-last-prompt))
+                       (= (cdr comint-last-prompt) (process-mark proc))
+                       (string-suffix-p "?- "
+                                        (buffer-substring-no-properties
+                                         (car comint-last-prompt)
+                                         (cdr comint-last-prompt)))))
+        (unless (process-live-p proc)
+          (error "Top-level process exited during benchmark"))
+        (accept-process-output proc 1))
+      (- (process-mark proc) start))))
+
+(defun sweeprolog-top-level-benchmark-transport (transport rounds lines)
+  "Benchmark the top-level TRANSPORT.
+
+TRANSPORT is a value for `sweeprolog-top-level-transport'.  Send
+ROUNDS trivial queries to a fresh top-level and then a query that
+prints LINES lines of output.  Return a list (TRANSPORT LATENCY
+THROUGHPUT) where LATENCY is the mean round-trip time of the
+trivial queries in seconds and THROUGHPUT is the rate of output in
+characters per second."
+  (let* ((sweeprolog-top-level-transport transport)
+         (sweeprolog-top-level-persistent-history nil)
+         (buf (sweeprolog-top-level-buffer
+               (generate-new-buffer-name " *sweeprolog-benchmark*")))
+         (proc (get-buffer-process buf)))
+    (unwind-protect
+        (let ((start (float-time)))
+          (dotimes (_ rounds)
+            (sweeprolog-top-level-benchmark--send proc "true.\n"))
+          (let* ((latency (/ (- (float-time) start) (max rounds 1)))
+                 (start (float-time))
+                 (chars (sweeprolog-top-level-benchmark--send
+                         proc
+                         (format "forall(between(1, %d, _), format(\"~`xt~72|~n\")).\n"
+                                 lines))))
+            (list transport latency (/ chars (max (- (float-time) start)
+                                                  1e-6)))))
+      (with-current-buffer buf
+        (sweeprolog-top-level-delete-process buf))
+      (kill-buffer buf))))
+
+;;;###autoload
+(defun sweeprolog-top-level-benchmark (&optional rounds lines)
+  "Compare the performance of the available top-level transports.
+
+For each transport that `sweeprolog-top-level-transport' can
+specify on this system, start a temporary top-level, measure the
+mean round-trip latency of ROUNDS trivial queries, and measure the
+throughput of a query that prints LINES lines of output.  ROUNDS
+defaults to 200 and LINES defaults to 20000.  Display the results
+and return them as a list of (TRANSPORT LATENCY THROUGHPUT) lists,
+see `sweeprolog-top-level-benchmark-transport'."
+  (interactive)
+  (sweeprolog-ensure-initialized)
+  (let ((results
+         (mapcar (lambda (transport)
+                   (message "Benchmarking %s top-level transport..." transport)
+                   (sweeprolog-top-level-benchmark-transport
+                    transport (or rounds 200) (or lines 20000)))
+                 (append (unless (memq system-type '(ms-dos windows-nt))
+                           (list 'pty))
+                         (when (featurep 'make-network-process
+                                         '(:family local))
+                           (list 'local))
+                         (list 'tcp)))))
+    (when (called-interactively-p 'interactive)
+      (with-current-buffer (get-buffer-create "*Sweep Top-level Benchmark*")
+        (let ((inhibit-read-only t))
+          (erase-buffer)
+          (insert (format "%-10s %16s %24s\n"
+                          "Transport" "Latency (ms)" "Throughput (chars/s)"))
+          (dolist (result results)
+            (insert (format "%-10s %16.3f %24.0f\n"
+                            (nth 0 result)
+                            (* 1000 (nth 1 result))
+                            (nth 2 result)))))
+        (special-mode)
+        (display-buffer (current-buffer))))
+    results))
+
+;;;###autoload
+(defun sweeprolog-memory-report ()
+  "Display a breakdown of the memory that the Prolog runtime uses.
+
+The report includes the atom, functor and clause tables, the stacks
+of each Prolog thread, the cross reference data and the stored
+comments of each source, the caches that Sweep maintains, and the
+memory files that hold buffer contents.\\<sweeprolog-memory-report-mode-map>
+In the report buffer, type \\[sweeprolog-memory-purge-xref] to
+discard cross reference data for files that you are not visiting
+and \\[sweeprolog-memory-collect-garbage] to reclaim unused atoms
+and clauses."
+  (interactive)
+  (sweeprolog-ensure-initialized)
+  (let ((buf (get-buffer-create "*Sweep Memory*")))
+    (with-current-buffer buf
+      (sweeprolog-memory-report-mode)
+      (sweeprolog-memory-report-mode--refresh)
+      (tabulated-list-print))
+    (pop-to-buffer buf)))
+
+(defun sweeprolog-indent-region-benchmark (beg end)
+  "Compare the ways to indent the region between BEG and END.
+
+Indent copies of the region line by line with
+`sweeprolog-indent-line', and in a single pass with
+`sweeprolog-indent-region', and report the time each method took
+and whether they agree.  Interactively, operate on the region if
+it is active, otherwise on the whole buffer.  The current buffer
+is not modified."
+  (interactive (if (use-region-p)
+                   (list (use-region-beginning) (use-region-end))
+                 (list (point-min) (point-max)))
+               sweeprolog-mode)
+  (unless sweeprolog--op-table
+    (sweeprolog--op-table-refresh))
+  (let ((text (buffer-substring-no-properties beg end))
+        (ops sweeprolog--op-table)
+        (results nil))
+    (dolist (fun (list #'indent-region-line-by-line
+                       #'sweeprolog-indent-region))
+      (with-temp-buffer
+        (insert text)
+        (let ((sweeprolog-enable-flymake nil))
+          (sweeprolog-mode))
+        (setq sweeprolog--op-table ops)
+        (let ((time (benchmark-elapse
+                      (funcall fun (point-min) (point-max)))))
+          (push (cons time (buffer-string)) results))))
+    (setq results (nreverse results))
+    (message "Line by line: %.3fs, single pass: %.3fs, %s"
+             (car (nth 0 results))
+             (car (nth 1 results))
+             (if (string= (cdr (nth 0 results)) (cdr (nth 1 results)))
+                 "same results"
+               "results differ"))))
+
+
 ;;;; Bug Reports
 
 (defvar reporter-prompt-for-summary-p)